@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui opengl multimediawidgets websockets
+QT       += core gui opengl multimediawidgets websockets concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -24,7 +24,18 @@ SOURCES += main.cpp\
     SeSceneLayer.cpp \
     SeScenePlayer.cpp \
     SeMosaicWindow.cpp \
-    SeWebSocket.cpp
+    SeMosaicFilter.cpp \
+    SeColorQuantizer.cpp \
+    SeVideoImporter.cpp \
+    SeImageImporter.cpp \
+    SeAnimationWriter.cpp \
+    SeGifWriter.cpp \
+    SeApngWriter.cpp \
+    SeVideoWriter.cpp \
+    SeThumbnailCache.cpp \
+    SeWebSocket.cpp \
+    SeAvrBinary.cpp \
+    SeAvrHeader.cpp
 
 HEADERS  += SeMainWindow.h \
     SeTreeScenes.h \
@@ -36,8 +47,19 @@ HEADERS  += SeMainWindow.h \
     SeSceneLayer.h \
     SeScenePlayer.h \
     SeMosaicWindow.h \
+    SeMosaicFilter.h \
+    SeColorQuantizer.h \
+    SeVideoImporter.h \
+    SeImageImporter.h \
+    SeAnimationWriter.h \
+    SeGifWriter.h \
+    SeApngWriter.h \
+    SeVideoWriter.h \
+    SeThumbnailCache.h \
     SeGeneral.h \
-    SeWebSocket.h
+    SeWebSocket.h \
+    SeAvrBinary.h \
+    SeAvrHeader.h
 
 FORMS    += SeMainWindow.ui \
     SeMosaicWindow.ui
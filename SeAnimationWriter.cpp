@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeAnimationWriter.h>
+
+// Qt
+#include <QFile>
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeAnimationWriter::SeAnimationWriter(const QString & filename)
+  : mNumberOfFrames(0)
+  , mFilename(filename)
+  , mPendingMsec(0)
+{
+}
+
+SeAnimationWriter::~SeAnimationWriter()
+{
+}
+
+bool SeAnimationWriter::addFrame(const QImage & image, int msec)
+{
+  if(image.isNull()) { return false; }
+
+  QImage img = image.convertToFormat(QImage::Format_RGB32);
+
+  if(mPending.isNull() == false && img.size() != mPending.size())
+  {
+    mErrorString = QString("Frame size %1x%2 differs from %3x%4")
+      .arg(img.width()).arg(img.height())
+      .arg(mPending.width()).arg(mPending.height());
+    return false;
+  }
+
+  if(mPending.isNull() == false && img == mPending)
+  {
+    mPendingMsec += msec;
+    return true;
+  }
+
+  this->flush();
+
+  mPending = img;
+  mPendingMsec = msec;
+
+  return true;
+}
+
+void SeAnimationWriter::flush()
+{
+  if(mPending.isNull()) { return; }
+
+  QRect rect;
+  if(mPrevious.isNull())
+  {
+    this->writeHeader(mData, mPending.size());
+    rect = mPending.rect();
+  }
+  else
+  {
+    rect = changedRect(mPrevious, mPending);
+  }
+
+  this->writeFrame(mData, mPending, rect, mPendingMsec);
+  mNumberOfFrames++;
+
+  mPrevious = mPending;
+  mPending = QImage();
+  mPendingMsec = 0;
+}
+
+bool SeAnimationWriter::finish()
+{
+  this->flush();
+
+  if(mNumberOfFrames == 0)
+  {
+    mErrorString = "No frames";
+    return false;
+  }
+
+  this->writeTrailer(mData);
+
+  QFile f(mFilename);
+  if(f.open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+  {
+    mErrorString = f.errorString();
+    return false;
+  }
+
+  bool res = f.write(mData) == mData.size();
+  if(res == false) { mErrorString = f.errorString(); }
+
+  return res;
+}
+
+QRect SeAnimationWriter::changedRect(const QImage & previous, const QImage & current)
+{
+  int x0 = current.width(), y0 = current.height(), x1 = -1, y1 = -1;
+
+  for(int y=0; y < current.height(); y++)
+  {
+    const QRgb *a = reinterpret_cast<const QRgb*>(previous.constScanLine(y));
+    const QRgb *b = reinterpret_cast<const QRgb*>(current.constScanLine(y));
+
+    int first = -1, last = -1;
+    for(int x=0; x < current.width(); x++)
+    {
+      if(a[x] != b[x])
+      {
+        if(first < 0) { first = x; }
+        last = x;
+      }
+    }
+
+    if(first < 0) { continue; }
+
+    x0 = qMin(x0, first);
+    x1 = qMax(x1, last);
+    y0 = qMin(y0, y);
+    y1 = y;
+  }
+
+  // addFrame() merges identical frames, keep at least one pixel anyway
+  if(x1 < 0) { return QRect(0, 0, 1, 1); }
+
+  return QRect(QPoint(x0, y0), QPoint(x1, y1));
+}
+
+void SeAnimationWriter::appendU16LE(QByteArray & out, int v)
+{
+  out.append((char) (v & 0xff));
+  out.append((char) ((v >> 8) & 0xff));
+}
+
+void SeAnimationWriter::appendU16BE(QByteArray & out, int v)
+{
+  out.append((char) ((v >> 8) & 0xff));
+  out.append((char) (v & 0xff));
+}
+
+void SeAnimationWriter::appendU32BE(QByteArray & out, quint32 v)
+{
+  out.append((char) ((v >> 24) & 0xff));
+  out.append((char) ((v >> 16) & 0xff));
+  out.append((char) ((v >> 8) & 0xff));
+  out.append((char) (v & 0xff));
+}
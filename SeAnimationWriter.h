@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SEANIMATIONWRITER_H__
+#define __SEANIMATIONWRITER_H__
+
+// Qt
+#include <QRect>
+#include <QImage>
+#include <QString>
+#include <QByteArray>
+
+/**
+ * @brief The SeAnimationWriter class
+ *
+ * Base of the native animation writers. Consecutive identical frames
+ * are merged into one frame with the summed duration, every other
+ * frame is handed to writeFrame() together with the rectangle which 
+ * changed since the previously written frame.
+ */
+class SeAnimationWriter
+{
+public:
+  explicit SeAnimationWriter(const QString & filename);
+  virtual ~SeAnimationWriter();
+
+  //! Appends \p image shown for \p msec milliseconds, all frames 
+  //! must have the size of the first one.
+  bool addFrame(const QImage & image, int msec);
+
+  //! Writes the pending frame and the file.
+  bool finish();
+
+  const QString & filename() const { return mFilename; }
+  const QString & errorString() const { return mErrorString; }
+
+  //! \return Number of frames written, i.e. after merging.
+  int numberOfFrames() const { return mNumberOfFrames; }
+
+protected:
+  //! Called once before the first frame.
+  virtual void writeHeader(QByteArray & out, const QSize & size) = 0;
+  //! \p rect is the part of \p image which differs from the previous 
+  //! frame, the whole image for the first frame.
+  virtual void writeFrame(QByteArray & out, const QImage & image, const QRect & rect, int msec) = 0;
+  //! Called once after the last frame, e.g. to patch frame counts.
+  virtual void writeTrailer(QByteArray & out) = 0;
+
+  static void appendU16LE(QByteArray & out, int v);
+  static void appendU16BE(QByteArray & out, int v);
+  static void appendU32BE(QByteArray & out, quint32 v);
+
+  int mNumberOfFrames;
+  QString mErrorString;
+
+private:
+  QString mFilename;
+  QByteArray mData;
+
+  QImage mPrevious;
+  QImage mPending;
+  int mPendingMsec;
+
+  void flush();
+  static QRect changedRect(const QImage & previous, const QImage & current);
+};
+
+#endif // __SEANIMATIONWRITER_H__
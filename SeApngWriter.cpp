@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeApngWriter.h>
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeApngWriter::SeApngWriter(const QString & filename)
+  : SeAnimationWriter(filename)
+  , mSequence(0)
+  , mActlOffset(-1)
+{
+}
+
+void SeApngWriter::writeHeader(QByteArray & out, const QSize & size)
+{
+  out.append("\x89PNG\r\n\x1a\n", 8);
+
+  QByteArray ihdr;
+  appendU32BE(ihdr, size.width());
+  appendU32BE(ihdr, size.height());
+  ihdr.append((char) 8);  // bit depth
+  ihdr.append((char) 2);  // truecolor
+  ihdr.append((char) 0);  // deflate
+  ihdr.append((char) 0);  // adaptive filtering
+  ihdr.append((char) 0);  // no interlace
+  appendChunk(out, "IHDR", ihdr);
+
+  // number of frames is patched by writeTrailer()
+  QByteArray actl;
+  appendU32BE(actl, 0);
+  appendU32BE(actl, 0);   // loop forever
+  mActlOffset = out.size();
+  appendChunk(out, "acTL", actl);
+}
+
+void SeApngWriter::writeFrame(QByteArray & out, const QImage & image, const QRect & rect, int msec)
+{
+  // delays above 65.5 s are stored in 1/100 s
+  int numerator = msec;
+  int denominator = 1000;
+  if(numerator > 0xffff)
+  {
+    numerator = qMin(msec / 10, 0xffff);
+    denominator = 100;
+  }
+
+  QByteArray fctl;
+  appendU32BE(fctl, mSequence++);
+  appendU32BE(fctl, rect.width());
+  appendU32BE(fctl, rect.height());
+  appendU32BE(fctl, rect.x());
+  appendU32BE(fctl, rect.y());
+  appendU16BE(fctl, numerator);
+  appendU16BE(fctl, denominator);
+  fctl.append((char) 0);  // APNG_DISPOSE_OP_NONE
+  fctl.append((char) 0);  // APNG_BLEND_OP_SOURCE
+  appendChunk(out, "fcTL", fctl);
+
+  QByteArray data = deflate(image, rect);
+
+  if(mNumberOfFrames == 0)
+  {
+    appendChunk(out, "IDAT", data);
+  }
+  else
+  {
+    QByteArray fdat;
+    appendU32BE(fdat, mSequence++);
+    fdat.append(data);
+    appendChunk(out, "fdAT", fdat);
+  }
+}
+
+void SeApngWriter::writeTrailer(QByteArray & out)
+{
+  if(mActlOffset >= 0)
+  {
+    // length(4) type(4) num_frames(4) num_plays(4) crc(4)
+    QByteArray frames;
+    appendU32BE(frames, mNumberOfFrames);
+    out.replace(mActlOffset + 8, 4, frames);
+
+    QByteArray crc;
+    appendU32BE(crc, crc32(out.constData() + mActlOffset + 4, 12));
+    out.replace(mActlOffset + 16, 4, crc);
+  }
+
+  appendChunk(out, "IEND", QByteArray());
+}
+
+void SeApngWriter::appendChunk(QByteArray & out, const char *type, const QByteArray & data)
+{
+  appendU32BE(out, data.size());
+  int start = out.size();
+  out.append(type, 4);
+  out.append(data);
+  appendU32BE(out, crc32(out.constData() + start, data.size() + 4));
+}
+
+quint32 SeApngWriter::crc32(const char *data, int length)
+{
+  static quint32 table[256];
+  static bool initialized = false;
+
+  if(initialized == false)
+  {
+    for(quint32 n=0; n < 256; n++)
+    {
+      quint32 c = n;
+      for(int k=0; k < 8; k++)
+      {
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+    initialized = true;
+  }
+
+  quint32 c = 0xffffffffu;
+  for(int i=0; i < length; i++)
+  {
+    c = table[(c ^ (quint8) data[i]) & 0xff] ^ (c >> 8);
+  }
+  return c ^ 0xffffffffu;
+}
+
+QByteArray SeApngWriter::deflate(const QImage & image, const QRect & rect)
+{
+  // every row uses the Sub filter, LED frames are mostly flat runs
+  QByteArray raw;
+  raw.reserve(rect.height() * (1 + rect.width() * 3));
+
+  for(int y=rect.top(); y <= rect.bottom(); y++)
+  {
+    const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+
+    raw.append((char) 1);
+
+    QRgb left = 0;
+    for(int x=rect.left(); x <= rect.right(); x++)
+    {
+      QRgb c = line[x];
+      raw.append((char) (qRed(c) - qRed(left)));
+      raw.append((char) (qGreen(c) - qGreen(left)));
+      raw.append((char) (qBlue(c) - qBlue(left)));
+      left = c;
+    }
+  }
+
+  // qCompress() prefixes the zlib stream with the uncompressed size
+  return qCompress(raw, 9).mid(4);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SEAPNGWRITER_H__
+#define __SEAPNGWRITER_H__
+
+// SceneEditor
+#include <SeAnimationWriter.h>
+
+/**
+ * @brief The SeApngWriter class
+ *
+ * Writes a looping animated PNG with 24 bit RGB frames. The first 
+ * frame is the default image, every further frame only covers the
+ * rectangle which changed. Image data is deflated with qCompress(),
+ * the frame count in acTL is patched when the file is finished.
+ */
+class SeApngWriter
+  : public SeAnimationWriter
+{
+public:
+  explicit SeApngWriter(const QString & filename);
+
+protected:
+  void writeHeader(QByteArray & out, const QSize & size);
+  void writeFrame(QByteArray & out, const QImage & image, const QRect & rect, int msec);
+  void writeTrailer(QByteArray & out);
+
+private:
+  quint32 mSequence;
+  int mActlOffset;
+
+  static void appendChunk(QByteArray & out, const char *type, const QByteArray & data);
+  static quint32 crc32(const char *data, int length);
+  static QByteArray deflate(const QImage & image, const QRect & rect);
+};
+
+#endif // __SEAPNGWRITER_H__
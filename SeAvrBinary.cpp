@@ -0,0 +1,470 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeAvrBinary.h>
+#include <SeSceneLayer.h>
+#include <SeColorQuantizer.h>
+
+// Qt
+#include <QMap>
+#include <QDebug>
+#include <QDataStream>
+
+#include <cstring>
+#include <algorithm>
+
+// ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeAvrPalette::SeAvrPalette()
+{
+}
+
+SeAvrPalette::SeAvrPalette(const QVector<QRgb> & colors)
+{
+  for(QRgb c : colors)
+  {
+    QRgb rgb = qRgb(qRed(c), qGreen(c), qBlue(c));
+    if(mColors.count() >= 256) { break; }
+    if(mColors.contains(rgb)) { continue; }
+    mColors.append(rgb);
+  }
+}
+
+SeAvrPalette SeAvrPalette::fromFrames(const QList< QVector<QRgb> > & frames, int maxColors)
+{
+  QHash<QRgb, int> histogram;
+  
+  // a held frame is appended as shared copy, i.e. counted once with 
+  // the number of its copies as weight
+  for(int i=0; i < frames.count(); )
+  {
+    const QVector<QRgb> & frame = frames.at(i);
+    int hold = 1;
+    while(i + hold < frames.count() && frames.at(i + hold).constData() == frame.constData())
+    {
+      ++hold;
+    }
+    i += hold;
+    
+    for(QRgb c : frame)
+    {
+      histogram[qRgb(qRed(c), qGreen(c), qBlue(c))] += hold;
+    }
+  }
+  
+  maxColors = qBound(1, maxColors, 256);
+  
+  if(histogram.count() > maxColors)
+  {
+    SeColorQuantizer quantizer(maxColors);
+    return SeAvrPalette(quantizer.build(histogram));
+  }
+  
+  QList< QPair<int, QRgb> > ordered;
+  for(auto it = histogram.constBegin(); it != histogram.constEnd(); ++it)
+  {
+    ordered.append(qMakePair(it.value(), it.key()));
+  }
+  
+  // most frequent colors first
+  std::sort(ordered.begin(), ordered.end(), [](const QPair<int, QRgb> & a, const QPair<int, QRgb> & b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+  });
+  
+  QVector<QRgb> colors;
+  for(int i=0; i < ordered.count() && i < maxColors; i++)
+  {
+    colors.append(ordered.at(i).second);
+  }
+  
+  if(colors.isEmpty()) { colors.append(qRgb(0, 0, 0)); }
+  
+  return SeAvrPalette(colors);
+}
+
+int SeAvrPalette::indexOf(QRgb c) const
+{
+  QRgb rgb = qRgb(qRed(c), qGreen(c), qBlue(c));
+
+  auto it = mLookup.constFind(rgb);
+  if(it != mLookup.constEnd()) { return it.value(); }
+  
+  int bestIndex = 0;
+  int bestDistance = -1;
+  
+  for(int i=0; i < mColors.count(); i++)
+  {
+    QRgb p = mColors.at(i);
+    int dr = qRed(p) - qRed(rgb);
+    int dg = qGreen(p) - qGreen(rgb);
+    int db = qBlue(p) - qBlue(rgb);
+    int d = dr * dr + dg * dg + db * db;
+    
+    if(bestDistance < 0 || d < bestDistance)
+    {
+      bestDistance = d;
+      bestIndex = i;
+    }
+    
+    if(d == 0) { break; }
+  }
+  
+  mLookup.insert(rgb, bestIndex);
+  
+  return bestIndex;
+}
+
+// ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeAvrBinary::SeAvrBinary(int rows, int columns)
+  : mRows(rows)
+  , mColumns(columns)
+  , mKeyFrameInterval(16)
+{
+}
+
+void SeAvrBinary::addFrame(SeSceneLayer *layer, int hold)
+{
+  if(layer == NULL) { return; }
+  this->addFrame(layer->toRgbBuffer(), hold);
+}
+
+void SeAvrBinary::addFrame(const QVector<QRgb> & frame, int hold)
+{
+  if(frame.count() != mRows * mColumns)
+  {
+    qDebug() << QString("Frame size mismatch: %1 instead of %2").arg(frame.count()).arg(mRows * mColumns);
+    return;
+  }
+  
+  // the copies share their data, encodeRecords() turns them into repeats
+  for(int i=0; i < hold; i++)
+  {
+    mFrames.append(frame);
+  }
+}
+
+QVector<quint8> SeAvrBinary::indexedFrame(const QVector<QRgb> & frame) const
+{
+  QVector<quint8> indices(frame.count());
+  for(int i=0; i < frame.count(); i++)
+  {
+    indices[i] = (quint8) mPalette.indexOf(frame.at(i));
+  }
+  return indices;
+}
+
+void SeAvrBinary::appendKeyRecord(QByteArray & records, const QVector<quint8> & indices)
+{
+  records.append((char) RecordKey);
+  
+  int i = 0;
+  while(i < indices.count())
+  {
+    quint8 index = indices.at(i);
+    int len = 1;
+    while(i + len < indices.count() && len < 255 && indices.at(i + len) == index)
+    {
+      ++len;
+    }
+    records.append((char) len);
+    records.append((char) index);
+    i += len;
+  }
+}
+
+void SeAvrBinary::appendDeltaRecord(QByteArray & records, const QVector<quint8> & previous, const QVector<quint8> & indices)
+{
+  records.append((char) RecordDelta);
+  
+  int n = indices.count();
+  int i = 0;
+  while(i < n)
+  {
+    int skip = 0;
+    while(i < n && skip < 255 && indices.at(i) == previous.at(i))
+    {
+      ++skip;
+      ++i;
+    }
+    
+    if(i >= n || indices.at(i) == previous.at(i))
+    {
+      // trailing unchanged LEDs or a skip longer than 255
+      records.append((char) skip);
+      records.append((char) 0);
+      records.append((char) 0);
+      continue;
+    }
+    
+    quint8 index = indices.at(i);
+    int len = 0;
+    while(i < n && len < 255 && indices.at(i) == index)
+    {
+      ++len;
+      ++i;
+    }
+    
+    records.append((char) skip);
+    records.append((char) len);
+    records.append((char) index);
+  }
+}
+
+QByteArray SeAvrBinary::encodeRecords()
+{
+  if(mPalette.isEmpty())
+  {
+    mPalette = SeAvrPalette::fromFrames(mFrames);
+  }
+  
+  mKeyFrames.clear();
+
+  QByteArray records;
+  QVector<QRgb> previousRgb;
+  QVector<quint8> previous;
+  int repeats = 0;
+  int frame = 0;
+  int sinceKeyFrame = 0;
+  
+  auto flushRepeats = [&]() {
+    while(repeats > 0)
+    {
+      int n = qMin(repeats, 0xffff);
+      records.append((char) RecordRepeat);
+      records.append((char) (n & 0xff));
+      records.append((char) ((n >> 8) & 0xff));
+      repeats -= n;
+    }
+  };
+  
+  for(const QVector<QRgb> & rgbFrame : mFrames)
+  {
+    if(rgbFrame == previousRgb)
+    {
+      ++repeats;
+      ++frame;
+      continue;
+    }
+    
+    previousRgb = rgbFrame;
+  
+    QVector<quint8> indices = this->indexedFrame(rgbFrame);
+    
+    if(indices == previous)
+    {
+      ++repeats;
+      ++frame;
+      continue;
+    }
+    
+    flushRepeats();
+    
+    QByteArray key;
+    appendKeyRecord(key, indices);
+    
+    bool forceKey = previous.isEmpty() || sinceKeyFrame >= mKeyFrameInterval;
+    if(forceKey == false)
+    {
+      QByteArray delta;
+      appendDeltaRecord(delta, previous, indices);
+      if(delta.size() < key.size())
+      {
+        records.append(delta);
+        ++sinceKeyFrame;
+        key.clear();
+      }
+    }
+    
+    if(key.isEmpty() == false)
+    {
+      SeAvrKeyFrame kf;
+      kf.frame = frame;
+      kf.offset = records.size();
+      mKeyFrames.append(kf);
+      
+      records.append(key);
+      sinceKeyFrame = 1;
+    }
+    
+    previous = indices;
+    ++frame;
+  }
+  
+  flushRepeats();
+  
+  return records;
+}
+
+QByteArray SeAvrBinary::encode()
+{
+  QByteArray records = this->encodeRecords();
+
+  QByteArray data;
+  QDataStream s(&data, QIODevice::WriteOnly);
+  s.setByteOrder(QDataStream::LittleEndian);
+  
+  s.writeRawData("SEAV", 4);
+  s << (quint8) 1;
+  s << (quint16) mRows;
+  s << (quint16) mColumns;
+  s << (quint32) mFrames.count();
+  
+  s << (quint16) mPalette.count();
+  for(QRgb c : mPalette.colors())
+  {
+    s << (quint8) qRed(c) << (quint8) qGreen(c) << (quint8) qBlue(c);
+  }
+  
+  s.writeRawData(records.constData(), records.size());
+  
+  return data;
+}
+
+bool SeAvrBinary::decode(const QByteArray & data, int & rows, int & columns, QList< QVector<QRgb> > & frames)
+{
+  QDataStream s(data);
+  s.setByteOrder(QDataStream::LittleEndian);
+  
+  char magic[4];
+  if(s.readRawData(magic, 4) != 4 || memcmp(magic, "SEAV", 4) != 0) { return false; }
+  
+  quint8 version; quint16 r, c; quint32 numberOfFrames; quint16 paletteSize;
+  s >> version >> r >> c >> numberOfFrames >> paletteSize;
+  if(s.status() != QDataStream::Ok || version != 1) { return false; }
+  
+  QVector<QRgb> palette;
+  for(int i=0; i < paletteSize; i++)
+  {
+    quint8 red, green, blue;
+    s >> red >> green >> blue;
+    palette.append(qRgb(red, green, blue));
+  }
+  if(s.status() != QDataStream::Ok) { return false; }
+  
+  rows = r;
+  columns = c;
+  
+  int headerSize = 4 + 1 + 2 + 2 + 4 + 2 + paletteSize * 3;
+  
+  if(decodeRecords(data.mid(headerSize), 0, palette, rows * columns, frames) == false)
+  {
+    return false;
+  }
+  
+  return frames.count() == (int) numberOfFrames;
+}
+
+bool SeAvrBinary::decodeRecords(
+    const QByteArray & records
+  , int offset
+  , const QVector<QRgb> & palette
+  , int n
+  , QList< QVector<QRgb> > & frames
+) {
+  frames.clear();
+
+  const uchar *p = (const uchar*) records.constData();
+  int size = records.size();
+  int pos = offset;
+  
+  QVector<QRgb> current;
+  
+  while(pos < size)
+  {
+    uchar record = p[pos++];
+    
+    if(record == RecordKey)
+    {
+      current = QVector<QRgb>(n);
+      int i = 0;
+      while(i < n)
+      {
+        if(pos + 2 > size) { return false; }
+        int len = p[pos++];
+        int index = p[pos++];
+        if(len == 0 || i + len > n || index >= palette.count()) { return false; }
+        std::fill(current.begin() + i, current.begin() + i + len, palette.at(index));
+        i += len;
+      }
+      frames.append(current);
+    }
+    else if(record == RecordDelta)
+    {
+      if(current.isEmpty()) { return false; }
+      int i = 0;
+      while(i < n)
+      {
+        if(pos + 3 > size) { return false; }
+        int skip = p[pos++];
+        int len = p[pos++];
+        int index = p[pos++];
+        if(i + skip + len > n || (len > 0 && index >= palette.count())) { return false; }
+        if(skip == 0 && len == 0) { return false; }
+        i += skip;
+        if(len > 0)
+        {
+          std::fill(current.begin() + i, current.begin() + i + len, palette.at(index));
+          i += len;
+        }
+      }
+      frames.append(current);
+    }
+    else if(record == RecordRepeat)
+    {
+      if(pos + 2 > size || current.isEmpty()) { return false; }
+      int count = p[pos] | (p[pos + 1] << 8);
+      pos += 2;
+      for(int i=0; i < count; i++)
+      {
+        frames.append(current);
+      }
+    }
+    else
+    {
+      return false;
+    }
+  }
+  
+  return true;
+}
+
+bool SeAvrBinary::verify(const QByteArray & data)
+{
+  int rows = 0;
+  int columns = 0;
+  QList< QVector<QRgb> > decoded;
+  
+  if(SeAvrBinary::decode(data, rows, columns, decoded) == false) { return false; }
+  if(rows != mRows || columns != mColumns) { return false; }
+  if(decoded.count() != mFrames.count()) { return false; }
+  
+  return this->compare(decoded);
+}
+
+bool SeAvrBinary::compare(const QList< QVector<QRgb> > & frames, int firstFrame)
+{
+  if(firstFrame < 0 || firstFrame + frames.count() > mFrames.count()) { return false; }
+
+  for(int f=0; f < frames.count(); f++)
+  {
+    const QVector<QRgb> & frame = mFrames.at(firstFrame + f);
+    const QVector<QRgb> & decoded = frames.at(f);
+    
+    if(decoded.count() != frame.count()) { return false; }
+    
+    for(int i=0; i < frame.count(); i++)
+    {
+      if(decoded.at(i) != mPalette.color(mPalette.indexOf(frame.at(i))))
+      {
+        return false;
+      }
+    }
+  }
+  
+  return true;
+}
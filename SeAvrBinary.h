@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SEAVRBINARY_H__
+#define __SEAVRBINARY_H__
+
+// Qt
+#include <QRgb>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+
+// forward-declaration
+class SeSceneLayer;
+
+/**
+ * @brief The SeAvrPalette class
+ *
+ * Indexed color table of at most 256 entries used by the
+ * AVR/Arduino deployment formats.
+ */
+class SeAvrPalette
+{
+public:
+  SeAvrPalette();
+  explicit SeAvrPalette(const QVector<QRgb> & colors);
+
+  //! \brief Creates the palette for a set of frames.
+  //! If more than \p maxColors are used, the palette is reduced by
+  //! SeColorQuantizer and all colors map to their nearest entry.
+  static SeAvrPalette fromFrames(const QList< QVector<QRgb> > & frames, int maxColors=256);
+
+  int count() const { return mColors.count(); }
+  bool isEmpty() const { return mColors.isEmpty(); }
+  QRgb color(int index) const { return mColors.at(index); }
+  const QVector<QRgb> & colors() const { return mColors; }
+
+  //! \return The index of \p rgb or of its nearest palette entry.
+  int indexOf(QRgb rgb) const;
+
+private:
+  QVector<QRgb> mColors;
+  mutable QHash<QRgb, int> mLookup;
+};
+
+/**
+ * @brief The SeAvrKeyFrame struct
+ * Entry of the random access table, \a offset is relative to
+ * the beginning of the record stream.
+ */
+struct SeAvrKeyFrame
+{
+  int frame;
+  int offset;
+};
+
+/**
+ * @brief The SeAvrBinary class
+ *
+ * Compact binary deployment format, all values are little endian:
+ *
+ * Format:
+ * --------------------------------------------------------------
+ * "SEAV" | version:u8 | rows:u16 | columns:u16 | frames:u32
+ * paletteSize:u16 | paletteSize * (red:u8, green:u8, blue:u8)
+ * records...
+ *
+ * 0x01 Key frame:  (length:u8, paletteIndex:u8)... run-length
+ *                  encoded LEDs in row-major order until all
+ *                  rows * columns LEDs are covered.
+ * 0x02 Repeat:     count:u16, the previous frame is shown
+ *                  count more times.
+ * 0x03 Delta:      (skip:u8, length:u8, paletteIndex:u8)... keeps
+ *                  skip LEDs of the previous frame and sets the
+ *                  next length LEDs, until all LEDs are covered.
+ * --------------------------------------------------------------
+ *
+ * Every keyFrameInterval() encoded frames a key frame is forced,
+ * so players can start decoding at any entry of keyFrames().
+ */
+class SeAvrBinary
+{
+public:
+  enum Record { RecordKey=0x01, RecordRepeat=0x02, RecordDelta=0x03 };
+
+  SeAvrBinary(int rows, int columns);
+
+  //! \brief Adds a frame which is shown \p hold times.
+  void addFrame(SeSceneLayer *layer, int hold=1);
+  void addFrame(const QVector<QRgb> & frame, int hold=1);
+
+  int numberOfFrames() const { return mFrames.count(); }
+  int numberOfRows() const { return mRows; }
+  int numberOfColumns() const { return mColumns; }
+
+  //! By default the palette is derived from the added frames.
+  void setPalette(const SeAvrPalette & palette) { mPalette = palette; }
+  const SeAvrPalette & palette() const { return mPalette; }
+
+  void setKeyFrameInterval(int frames) { mKeyFrameInterval = qMax(1, frames); }
+  int keyFrameInterval() const { return mKeyFrameInterval; }
+
+  //! \return The complete file, i.e. header, palette and records.
+  QByteArray encode();
+  //! \return The record stream only, keyFrames() is updated.
+  QByteArray encodeRecords();
+
+  const QList<SeAvrKeyFrame> & keyFrames() const { return mKeyFrames; }
+
+  //! Host-side reference decoder.
+  //! \return False if \p data is not a valid stream.
+  static bool decode(const QByteArray & data, int & rows, int & columns, QList< QVector<QRgb> > & frames);
+  
+  //! Host-side reference decoder of a record stream, decoding starts at 
+  //! \p offset which has to point to a key frame record.
+  static bool decodeRecords(
+      const QByteArray & records
+    , int offset
+    , const QVector<QRgb> & palette
+    , int numberOfLeds
+    , QList< QVector<QRgb> > & frames);
+
+  //! Decodes \p data and compares it with the palette mapped frames.
+  bool verify(const QByteArray & data);
+  
+  //! Compares \p frames with the palette mapped frames starting at \p firstFrame.
+  bool compare(const QList< QVector<QRgb> > & frames, int firstFrame=0);
+
+private:
+  int mRows;
+  int mColumns;
+  int mKeyFrameInterval;
+  QList< QVector<QRgb> > mFrames;
+  QList<SeAvrKeyFrame> mKeyFrames;
+  SeAvrPalette mPalette;
+  
+  QVector<quint8> indexedFrame(const QVector<QRgb> & frame) const;
+  static void appendKeyRecord(QByteArray & records, const QVector<quint8> & indices);
+  static void appendDeltaRecord(QByteArray & records, const QVector<quint8> & previous, const QVector<quint8> & indices);
+};
+
+#endif // __SEAVRBINARY_H__
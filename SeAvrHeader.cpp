@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeAvrHeader.h>
+#include <SeSceneLayer.h>
+
+// Qt
+#include <QRegExp>
+#include <QDateTime>
+#include <QTextStream>
+
+// ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeAvrHeader::SeAvrHeader(const QString & name, int rows, int columns)
+  : mBinary(rows, columns)
+  , mDataSize(0)
+{
+  mName = name.toLower();
+  mName.replace(QRegExp("[^a-z0-9_]"), "_");
+  if(mName.isEmpty() || mName.at(0).isDigit())
+  {
+    mName.prepend("scene_");
+  }
+}
+
+void SeAvrHeader::addFrame(SeSceneLayer *layer, double duration)
+{
+  if(layer == NULL) { return; }
+
+  mBinary.addFrame(layer);
+  mFrameMsec.append(qRound(duration * 1000.0));
+}
+
+void SeAvrHeader::addLayer(double delay, int firstFrame)
+{
+  mLayers.append(qMakePair(qRound(delay * 1000.0), firstFrame));
+}
+
+QString SeAvrHeader::byteTable(const QByteArray & data)
+{
+  QString s;
+  
+  for(int i=0; i < data.size(); i++)
+  {
+    if(i % 16 == 0) { s += "\n  "; }
+    s += QString("0x%1").arg((uchar) data.at(i), 2, 16, QChar('0'));
+    if(i + 1 < data.size()) { s += ", "; }
+  }
+  
+  return s + "\n";
+}
+
+QString SeAvrHeader::intTable(const QList<int> & values)
+{
+  QString s;
+  
+  for(int i=0; i < values.count(); i++)
+  {
+    if(i % 12 == 0) { s += "\n  "; }
+    s += QString::number(values.at(i));
+    if(i + 1 < values.count()) { s += ", "; }
+  }
+  
+  return s + "\n";
+}
+
+QString SeAvrHeader::uintType(const QList<int> & values)
+{
+  for(int v : values)
+  {
+    if(v > 0xffff) { return "uint32_t"; }
+  }
+  return "uint16_t";
+}
+
+int SeAvrHeader::uintSize(const QList<int> & values)
+{
+  return uintType(values) == "uint32_t" ? 4 : 2;
+}
+
+QString SeAvrHeader::generate()
+{
+  mRecords = mBinary.encodeRecords();
+  
+  const SeAvrPalette & palette = mBinary.palette();
+  const QList<SeAvrKeyFrame> & keyFrames = mBinary.keyFrames();
+  
+  QString offsetType = mRecords.size() > 0xffff ? "uint32_t" : "uint16_t";
+  int offsetSize = mRecords.size() > 0xffff ? 4 : 2;
+  
+  QByteArray paletteBytes;
+  for(QRgb c : palette.colors())
+  {
+    paletteBytes.append((char) qRed(c));
+    paletteBytes.append((char) qGreen(c));
+    paletteBytes.append((char) qBlue(c));
+  }
+  
+  QList<int> keyFrameFrames;
+  QList<int> keyFrameOffsets;
+  for(const SeAvrKeyFrame & kf : keyFrames)
+  {
+    keyFrameFrames.append(kf.frame);
+    keyFrameOffsets.append(kf.offset);
+  }
+  
+  // frames with the same duration are merged
+  QList<int> timings;
+  for(int i=0; i < mFrameMsec.count(); i++)
+  {
+    int msec = mFrameMsec.at(i);
+    int n = timings.count();
+    if(n >= 2 && timings.at(n - 1) == msec && timings.at(n - 2) < 0xffff)
+    {
+      timings[n - 2] += 1;
+    }
+    else
+    {
+      timings << 1 << msec;
+    }
+  }
+  
+  QList<int> layerDelays;
+  QList<int> layerFirstFrames;
+  for(const QPair<int, int> & l : mLayers)
+  {
+    layerDelays.append(l.first);
+    layerFirstFrames.append(l.second);
+  }
+  
+  // tables use 16 bit entries unless a value does not fit
+  QString keyFrameType = uintType(keyFrameFrames);
+  QString timingType = uintType(timings);
+  QString layerDelayType = uintType(layerDelays);
+  QString layerFrameType = uintType(layerFirstFrames);
+  
+  mDataSize = paletteBytes.size()
+            + mRecords.size()
+            + keyFrames.count() * (uintSize(keyFrameFrames) + offsetSize)
+            + timings.count() * uintSize(timings)
+            + mLayers.count() * (uintSize(layerDelays) + uintSize(layerFirstFrames));
+  
+  QString N = mName.toUpper();
+  QString n = mName;
+  
+  QString s; QTextStream ss(&s);
+  
+  ss << "/*\n";
+  ss << " * Generated by SceneEditor, " << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n";
+  ss << " * Do not edit, changes are overwritten by the next deployment.\n";
+  ss << " *\n";
+  ss << " * Records: 0x01 key frame (length, index)...,\n";
+  ss << " *          0x02 repeat count:u16 (little endian),\n";
+  ss << " *          0x03 delta frame (skip, length, index)...\n";
+  ss << " */\n\n";
+  ss << "#ifndef __" << N << "_H__\n";
+  ss << "#define __" << N << "_H__\n\n";
+  ss << "#include <stdint.h>\n\n";
+  ss << "#ifdef __AVR__\n";
+  ss << "  #include <avr/pgmspace.h>\n";
+  ss << "#else\n";
+  ss << "  #ifndef PROGMEM\n";
+  ss << "    #define PROGMEM\n";
+  ss << "  #endif\n";
+  ss << "#endif\n\n";
+  
+  ss << "#define " << N << "_ROWS " << mBinary.numberOfRows() << "\n";
+  ss << "#define " << N << "_COLUMNS " << mBinary.numberOfColumns() << "\n";
+  ss << "#define " << N << "_FRAMES " << mBinary.numberOfFrames() << "\n";
+  ss << "#define " << N << "_PALETTE_SIZE " << palette.count() << "\n";
+  ss << "#define " << N << "_RECORDS_SIZE " << mRecords.size() << "\n";
+  ss << "#define " << N << "_KEYFRAMES " << keyFrames.count() << "\n";
+  ss << "#define " << N << "_TIMINGS " << timings.count() / 2 << "\n";
+  ss << "#define " << N << "_LAYERS " << mLayers.count() << "\n\n";
+  
+  ss << "#define " << N << "_RECORD_KEY    0x01\n";
+  ss << "#define " << N << "_RECORD_REPEAT 0x02\n";
+  ss << "#define " << N << "_RECORD_DELTA  0x03\n\n";
+  
+  // avr-gcc rejects arrays of zero length, empty tables are left out
+  if(paletteBytes.isEmpty() == false)
+  {
+    ss << "const uint8_t " << n << "_palette[" << N << "_PALETTE_SIZE * 3] PROGMEM = {"
+       << byteTable(paletteBytes) << "};\n\n";
+  }
+  
+  if(mRecords.isEmpty() == false)
+  {
+    ss << "const uint8_t " << n << "_records[" << N << "_RECORDS_SIZE] PROGMEM = {"
+       << byteTable(mRecords) << "};\n\n";
+  }
+  
+  if(keyFrames.isEmpty() == false)
+  {
+    ss << "const " << keyFrameType << " " << n << "_keyframe_frame[" << N << "_KEYFRAMES] PROGMEM = {"
+       << intTable(keyFrameFrames) << "};\n\n";
+    ss << "const " << offsetType << " " << n << "_keyframe_offset[" << N << "_KEYFRAMES] PROGMEM = {"
+       << intTable(keyFrameOffsets) << "};\n\n";
+  }
+  
+  if(timings.isEmpty() == false)
+  {
+    ss << "const " << timingType << " " << n << "_timing[" << N << "_TIMINGS][2] PROGMEM = {"
+       << intTable(timings) << "};\n\n";
+  }
+  
+  if(mLayers.isEmpty() == false)
+  {
+    ss << "const " << layerDelayType << " " << n << "_layer_delay_ms[" << N << "_LAYERS] PROGMEM = {"
+       << intTable(layerDelays) << "};\n\n";
+    ss << "const " << layerFrameType << " " << n << "_layer_first_frame[" << N << "_LAYERS] PROGMEM = {"
+       << intTable(layerFirstFrames) << "};\n\n";
+  }
+  
+  ss << "#endif // __" << N << "_H__\n";
+  
+  ss.flush();
+  
+  return s;
+}
+
+bool SeAvrHeader::verify()
+{
+  if(mRecords.isEmpty()) { return false; }
+
+  QVector<QRgb> palette = mBinary.palette().colors();
+  int n = mBinary.numberOfRows() * mBinary.numberOfColumns();
+  
+  QList< QVector<QRgb> > frames;
+  
+  if(SeAvrBinary::decodeRecords(mRecords, 0, palette, n, frames) == false) { return false; }
+  if(frames.count() != mBinary.numberOfFrames()) { return false; }
+  if(mBinary.compare(frames) == false) { return false; }
+  
+  // random access, each key frame is decoded up to the next one
+  const QList<SeAvrKeyFrame> & keyFrames = mBinary.keyFrames();
+  for(int i=0; i < keyFrames.count(); i++)
+  {
+    const SeAvrKeyFrame & kf = keyFrames.at(i);
+    int end = i + 1 < keyFrames.count() ? keyFrames.at(i + 1).offset : mRecords.size();
+    
+    QByteArray records = QByteArray::fromRawData(mRecords.constData(), end);
+    
+    if(SeAvrBinary::decodeRecords(records, kf.offset, palette, n, frames) == false) { return false; }
+    if(frames.isEmpty() || mBinary.compare(frames, kf.frame) == false) { return false; }
+  }
+  
+  return true;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SEAVRHEADER_H__
+#define __SEAVRHEADER_H__
+
+// SceneEditor
+#include <SeAvrBinary.h>
+
+// Qt
+#include <QPair>
+#include <QList>
+#include <QString>
+#include <QByteArray>
+
+// forward-declaration
+class SeSceneLayer;
+
+/**
+ * @brief The SeAvrHeader class
+ *
+ * Generates a ready-to-compile C header for AVR/Arduino targets.
+ * The frames are stored as SeAvrBinary record stream in PROGMEM,
+ * followed by the palette, the key frame table for random access
+ * and the timing tables.
+ *
+ * Generated symbols, NAME is derived from the project name:
+ * --------------------------------------------------------------
+ * NAME_ROWS, NAME_COLUMNS, NAME_FRAMES, NAME_PALETTE_SIZE,
+ * NAME_KEYFRAMES, NAME_TIMINGS, NAME_LAYERS
+ * name_palette[]          red, green, blue per palette entry
+ * name_records[]          SeAvrBinary records (key, delta, repeat)
+ * name_keyframe_frame[]   frame number of each key frame
+ * name_keyframe_offset[]  byte offset of each key frame record
+ * name_timing[][2]        (frame count, msec per frame) runs
+ * name_layer_delay_ms[]   delay of each source layer
+ * name_layer_first_frame[] first frame of each source layer
+ * --------------------------------------------------------------
+ * Tables are uint16_t unless a value needs 32 bit, empty tables
+ * are not generated.
+ */
+class SeAvrHeader
+{
+public:
+  SeAvrHeader(const QString & name, int rows, int columns);
+
+  //! \brief Adds a frame which is shown for \p duration seconds.
+  void addFrame(SeSceneLayer *layer, double duration);
+  //! \brief Adds a timing entry of a source layer.
+  void addLayer(double delay, int firstFrame);
+
+  SeAvrBinary & binary() { return mBinary; }
+  
+  //! \return Size in bytes of all generated PROGMEM tables.
+  int dataSize() const { return mDataSize; }
+
+  QString generate();
+
+  //! Decodes the generated records with the reference decoder, 
+  //! from the beginning and from every key frame up to the next one.
+  bool verify();
+
+private:
+  QString mName;
+  SeAvrBinary mBinary;
+  QList<int> mFrameMsec;
+  QList< QPair<int, int> > mLayers;
+  QByteArray mRecords;
+  int mDataSize;
+  
+  static QString byteTable(const QByteArray & data);
+  static QString intTable(const QList<int> & values);
+  //! \return uint16_t, or uint32_t if one of \p values needs it.
+  static QString uintType(const QList<int> & values);
+  static int uintSize(const QList<int> & values);
+};
+
+#endif // __SEAVRHEADER_H__
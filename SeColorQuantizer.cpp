@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeColorQuantizer.h>
+
+// Qt
+#include <QHash>
+#include <QtConcurrent>
+
+// C++
+#include <cfloat>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SE_QUANTIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+//! Inputs with fewer samples are assigned on the calling thread.
+#define SE_QUANTIZER_CHUNK 4096
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+namespace {
+
+  struct SeQuantizerChunk
+  {
+    int first;
+    int last;
+    // per palette entry: red, green, blue and weight sums
+    std::vector<double> sums;
+  };
+
+  inline int channel(QRgb c, int ch)
+  {
+    return ch == 0 ? qRed(c) : (ch == 1 ? qGreen(c) : qBlue(c));
+  }
+
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeColorQuantizer::SeColorQuantizer(int maxColors)
+  : mMaxColors(qBound(1, maxColors, 256))
+  , mIterations(8)
+{
+}
+
+const QVector<QRgb> & SeColorQuantizer::build(const QImage & image)
+{
+  QImage img = image.convertToFormat(QImage::Format_RGB32);
+
+  QVector<QRgb> colors;
+  colors.reserve(img.width() * img.height());
+
+  for(int y=0; y < img.height(); y++)
+  {
+    const QRgb *line = reinterpret_cast<const QRgb*>(img.constScanLine(y));
+    for(int x=0; x < img.width(); x++)
+    {
+      colors.append(line[x]);
+    }
+  }
+
+  return this->build(colors);
+}
+
+const QVector<QRgb> & SeColorQuantizer::build(const QVector<QRgb> & input)
+{
+  // identical colors become one weighted sample
+  QHash<QRgb, int> histogram;
+  for(QRgb c : input)
+  {
+    ++histogram[qRgb(qRed(c), qGreen(c), qBlue(c))];
+  }
+
+  return this->build(histogram);
+}
+
+const QVector<QRgb> & SeColorQuantizer::build(const QHash<QRgb, int> & histogram)
+{
+  QVector<QRgb> colors;
+  QVector<int> weights;
+  colors.reserve(histogram.count());
+  weights.reserve(histogram.count());
+
+  for(auto it = histogram.constBegin(); it != histogram.constEnd(); ++it)
+  {
+    colors.append(it.key());
+  }
+
+  // QHash order is random, a sorted input keeps palettes reproducible
+  std::sort(colors.begin(), colors.end());
+  for(QRgb c : colors)
+  {
+    weights.append(histogram.value(c));
+  }
+
+  if(colors.count() <= mMaxColors)
+  {
+    mPalette = colors;
+    if(mPalette.isEmpty()) { mPalette.append(qRgb(0, 0, 0)); }
+    this->updatePlanes();
+    return mPalette;
+  }
+
+  this->medianCut(colors, weights);
+  this->updatePlanes();
+  this->kMeans(colors, weights);
+
+  return mPalette;
+}
+
+void SeColorQuantizer::setPalette(const QVector<QRgb> & palette)
+{
+  mPalette = palette;
+  this->updatePlanes();
+}
+
+void SeColorQuantizer::medianCut(const QVector<QRgb> & colors, const QVector<int> & weights)
+{
+  QVector<int> order(colors.count());
+  for(int i=0; i < order.count(); i++) { order[i] = i; }
+
+  QList< QPair<int, int> > boxes;
+  boxes.append(qMakePair(0, (int) order.count()));
+
+  while(boxes.count() < mMaxColors)
+  {
+    // split the box with the widest channel range
+    int bestBox = -1;
+    int bestChannel = 0;
+    int bestRange = 0;
+
+    for(int b=0; b < boxes.count(); b++)
+    {
+      const QPair<int, int> & box = boxes.at(b);
+      if(box.second - box.first < 2) { continue; }
+
+      int lo[3] = { 255, 255, 255 };
+      int hi[3] = { 0, 0, 0 };
+      for(int i=box.first; i < box.second; i++)
+      {
+        QRgb c = colors.at(order.at(i));
+        for(int ch=0; ch < 3; ch++)
+        {
+          lo[ch] = qMin(lo[ch], channel(c, ch));
+          hi[ch] = qMax(hi[ch], channel(c, ch));
+        }
+      }
+
+      for(int ch=0; ch < 3; ch++)
+      {
+        if(hi[ch] - lo[ch] > bestRange)
+        {
+          bestRange = hi[ch] - lo[ch];
+          bestChannel = ch;
+          bestBox = b;
+        }
+      }
+    }
+
+    if(bestBox < 0) { break; }
+
+    QPair<int, int> box = boxes.at(bestBox);
+
+    std::sort(order.begin() + box.first, order.begin() + box.second, [&](int a, int b) {
+      return channel(colors.at(a), bestChannel) < channel(colors.at(b), bestChannel);
+    });
+
+    // weighted median, both halves keep at least one color
+    qint64 total = 0;
+    for(int i=box.first; i < box.second; i++) { total += weights.at(order.at(i)); }
+
+    qint64 sum = 0;
+    int split = box.first + 1;
+    for(int i=box.first; i < box.second - 1; i++)
+    {
+      sum += weights.at(order.at(i));
+      split = i + 1;
+      if(2 * sum >= total) { break; }
+    }
+
+    boxes[bestBox] = qMakePair(box.first, split);
+    boxes.append(qMakePair(split, box.second));
+  }
+
+  mPalette.clear();
+
+  for(const QPair<int, int> & box : boxes)
+  {
+    double r = 0, g = 0, b = 0, w = 0;
+    for(int i=box.first; i < box.second; i++)
+    {
+      QRgb c = colors.at(order.at(i));
+      double weight = weights.at(order.at(i));
+      r += qRed(c) * weight;
+      g += qGreen(c) * weight;
+      b += qBlue(c) * weight;
+      w += weight;
+    }
+    mPalette.append(qRgb(qRound(r / w), qRound(g / w), qRound(b / w)));
+  }
+}
+
+void SeColorQuantizer::kMeans(const QVector<QRgb> & colors, const QVector<int> & weights)
+{
+  const int k = mPalette.count();
+
+  QVector<SeQuantizerChunk> chunks;
+  for(int first=0; first < colors.count(); first += SE_QUANTIZER_CHUNK)
+  {
+    SeQuantizerChunk chunk;
+    chunk.first = first;
+    chunk.last = qMin(first + SE_QUANTIZER_CHUNK, (int) colors.count());
+    chunks.append(chunk);
+  }
+
+  auto assign = [&](SeQuantizerChunk & chunk) {
+    chunk.sums.assign(k * 4, 0.0);
+    for(int i=chunk.first; i < chunk.last; i++)
+    {
+      QRgb c = colors.at(i);
+      double w = weights.at(i);
+      double *s = &chunk.sums[this->nearest(qRed(c), qGreen(c), qBlue(c)) * 4];
+      s[0] += qRed(c) * w;
+      s[1] += qGreen(c) * w;
+      s[2] += qBlue(c) * w;
+      s[3] += w;
+    }
+  };
+
+  for(int iteration=0; iteration < mIterations; iteration++)
+  {
+    if(chunks.count() > 1)
+    {
+      QtConcurrent::blockingMap(chunks, assign);
+    }
+    else
+    {
+      for(SeQuantizerChunk & chunk : chunks) { assign(chunk); }
+    }
+
+    bool changed = false;
+
+    for(int j=0; j < k; j++)
+    {
+      double r = 0, g = 0, b = 0, w = 0;
+      for(const SeQuantizerChunk & chunk : chunks)
+      {
+        r += chunk.sums[j * 4];
+        g += chunk.sums[j * 4 + 1];
+        b += chunk.sums[j * 4 + 2];
+        w += chunk.sums[j * 4 + 3];
+      }
+
+      // entries without any color keep their position
+      if(w <= 0) { continue; }
+
+      QRgb c = qRgb(qRound(r / w), qRound(g / w), qRound(b / w));
+      if(c != mPalette.at(j))
+      {
+        mPalette[j] = c;
+        changed = true;
+      }
+    }
+
+    if(changed == false) { break; }
+
+    this->updatePlanes();
+  }
+}
+
+void SeColorQuantizer::updatePlanes()
+{
+  size_t n = ((size_t) mPalette.count() + 3) & ~((size_t) 3);
+
+  // padding entries are too far away to ever be the nearest one
+  mRed.assign(n, 1e9f);
+  mGreen.assign(n, 1e9f);
+  mBlue.assign(n, 1e9f);
+
+  for(int i=0; i < mPalette.count(); i++)
+  {
+    mRed[i] = qRed(mPalette.at(i));
+    mGreen[i] = qGreen(mPalette.at(i));
+    mBlue[i] = qBlue(mPalette.at(i));
+  }
+}
+
+int SeColorQuantizer::nearest(float r, float g, float b) const
+{
+  const size_t n = mRed.size();
+  if(n == 0) { return 0; }
+
+#ifdef SE_QUANTIZER_SSE2
+  const __m128 vr = _mm_set1_ps(r);
+  const __m128 vg = _mm_set1_ps(g);
+  const __m128 vb = _mm_set1_ps(b);
+  const __m128i four = _mm_set1_epi32(4);
+
+  __m128 best = _mm_set1_ps(FLT_MAX);
+  __m128i bestIndex = _mm_setzero_si128();
+  __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+
+  for(size_t i=0; i < n; i += 4)
+  {
+    __m128 dr = _mm_sub_ps(_mm_loadu_ps(&mRed[i]), vr);
+    __m128 dg = _mm_sub_ps(_mm_loadu_ps(&mGreen[i]), vg);
+    __m128 db = _mm_sub_ps(_mm_loadu_ps(&mBlue[i]), vb);
+    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+    __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+    best = _mm_min_ps(d, best);
+    bestIndex = _mm_or_si128(_mm_and_si128(closer, index), _mm_andnot_si128(closer, bestIndex));
+    index = _mm_add_epi32(index, four);
+  }
+
+  float distances[4];
+  int indices[4];
+  _mm_storeu_ps(distances, best);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), bestIndex);
+
+  int result = indices[0];
+  float resultDistance = distances[0];
+  for(int lane=1; lane < 4; lane++)
+  {
+    if(distances[lane] < resultDistance
+       || (distances[lane] == resultDistance && indices[lane] < result))
+    {
+      result = indices[lane];
+      resultDistance = distances[lane];
+    }
+  }
+  return result;
+#else
+  int result = 0;
+  float resultDistance = FLT_MAX;
+  for(size_t i=0; i < n; i++)
+  {
+    float dr = mRed[i] - r;
+    float dg = mGreen[i] - g;
+    float db = mBlue[i] - b;
+    float d = dr * dr + dg * dg + db * db;
+    if(d < resultDistance)
+    {
+      resultDistance = d;
+      result = (int) i;
+    }
+  }
+  return result;
+#endif
+}
+
+int SeColorQuantizer::indexOf(QRgb c) const
+{
+  return this->nearest(qRed(c), qGreen(c), qBlue(c));
+}
+
+QImage SeColorQuantizer::apply(const QImage & image) const
+{
+  if(image.isNull() || mPalette.isEmpty()) { return image; }
+
+  QImage result = image.convertToFormat(QImage::Format_RGB32);
+
+  for(int y=0; y < result.height(); y++)
+  {
+    QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
+    for(int x=0; x < result.width(); x++)
+    {
+      line[x] = mPalette.at(this->indexOf(line[x]));
+    }
+  }
+
+  return result;
+}
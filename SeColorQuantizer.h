@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SECOLORQUANTIZER_H__
+#define __SECOLORQUANTIZER_H__
+
+// Qt
+#include <QRgb>
+#include <QHash>
+#include <QImage>
+#include <QVector>
+
+// C++
+#include <vector>
+
+#define SE_QUANTIZER_COLORS 16
+
+/**
+ * @brief The SeColorQuantizer class
+ *
+ * Reduces a set of colors to a small palette. The initial palette
+ * is found by median-cut, afterwards a few k-means iterations move
+ * each entry to the mean of the colors it represents. Identical
+ * input colors are merged into weighted samples first, the nearest
+ * palette entry is searched with SSE2 when available and the
+ * assignment of large inputs is split over the global thread pool.
+ */
+class SeColorQuantizer
+{
+public:
+  explicit SeColorQuantizer(int maxColors=SE_QUANTIZER_COLORS);
+
+  void setMaxColors(int maxColors) { mMaxColors = qBound(1, maxColors, 256); }
+  int maxColors() const { return mMaxColors; }
+
+  void setIterations(int iterations) { mIterations = qMax(0, iterations); }
+  int iterations() const { return mIterations; }
+
+  //! Computes the palette for \p colors, the alpha channel is ignored.
+  const QVector<QRgb> & build(const QVector<QRgb> & colors);
+  const QVector<QRgb> & build(const QImage & image);
+  //! Computes the palette for colors which occur \p histogram times.
+  const QVector<QRgb> & build(const QHash<QRgb, int> & histogram);
+
+  //! Uses \p palette as is, e.g. a fixed hardware palette.
+  void setPalette(const QVector<QRgb> & palette);
+  const QVector<QRgb> & palette() const { return mPalette; }
+
+  //! \return Index of the nearest palette entry.
+  int indexOf(QRgb c) const;
+  QRgb map(QRgb c) const { return mPalette.isEmpty() ? c : mPalette.at(indexOf(c)); }
+
+  //! \return \p image with every pixel replaced by its palette color.
+  QImage apply(const QImage & image) const;
+
+private:
+  int mMaxColors;
+  int mIterations;
+
+  QVector<QRgb> mPalette;
+
+  // palette as planar floats, padded to a multiple of four entries
+  std::vector<float> mRed;
+  std::vector<float> mGreen;
+  std::vector<float> mBlue;
+
+  void updatePlanes();
+  int nearest(float r, float g, float b) const;
+
+  void medianCut(const QVector<QRgb> & colors, const QVector<int> & weights);
+  void kMeans(const QVector<QRgb> & colors, const QVector<int> & weights);
+};
+
+#endif // __SECOLORQUANTIZER_H__
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeGifWriter.h>
+#include <SeColorQuantizer.h>
+
+// Qt
+#include <QHash>
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+namespace {
+
+  //! Packs variable sized codes LSB first into sub-blocks of 255 bytes.
+  class SeGifBitWriter
+  {
+  public:
+    explicit SeGifBitWriter(QByteArray & out) : mOut(out), mBits(0), mNumberOfBits(0) { }
+
+    void write(int code, int size)
+    {
+      mBits |= ((quint32) code) << mNumberOfBits;
+      mNumberOfBits += size;
+      while(mNumberOfBits >= 8)
+      {
+        this->put((char) (mBits & 0xff));
+        mBits >>= 8;
+        mNumberOfBits -= 8;
+      }
+    }
+
+    void finish()
+    {
+      if(mNumberOfBits > 0) { this->put((char) (mBits & 0xff)); }
+      mBits = 0;
+      mNumberOfBits = 0;
+      this->flushBlock();
+      mOut.append((char) 0);
+    }
+
+  private:
+    QByteArray & mOut;
+    QByteArray mBlock;
+    quint32 mBits;
+    int mNumberOfBits;
+
+    void put(char c)
+    {
+      mBlock.append(c);
+      if(mBlock.size() == 255) { this->flushBlock(); }
+    }
+
+    void flushBlock()
+    {
+      if(mBlock.isEmpty()) { return; }
+      mOut.append((char) mBlock.size());
+      mOut.append(mBlock);
+      mBlock.clear();
+    }
+  };
+
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeGifWriter::SeGifWriter(const QString & filename)
+  : SeAnimationWriter(filename)
+  , mDelayError(0)
+{
+}
+
+void SeGifWriter::writeHeader(QByteArray & out, const QSize & size)
+{
+  out.append("GIF89a", 6);
+  appendU16LE(out, size.width());
+  appendU16LE(out, size.height());
+  out.append((char) 0x00);  // no global color table
+  out.append((char) 0x00);  // background color
+  out.append((char) 0x00);  // pixel aspect ratio
+
+  // NETSCAPE2.0 application extension, loop forever
+  out.append((char) 0x21);
+  out.append((char) 0xff);
+  out.append((char) 0x0b);
+  out.append("NETSCAPE2.0", 11);
+  out.append((char) 0x03);
+  out.append((char) 0x01);
+  appendU16LE(out, 0);
+  out.append((char) 0x00);
+}
+
+void SeGifWriter::writeFrame(QByteArray & out, const QImage & image, const QRect & rect, int msec)
+{
+  QImage sub = image.copy(rect);
+
+  // local color table, exact if the frame has few enough colors
+  QVector<QRgb> palette;
+  QHash<QRgb, int> lookup;
+  bool exact = true;
+
+  for(int y=0; y < sub.height() && exact; y++)
+  {
+    const QRgb *line = reinterpret_cast<const QRgb*>(sub.constScanLine(y));
+    for(int x=0; x < sub.width(); x++)
+    {
+      QRgb c = line[x] | 0xff000000;
+      if(lookup.contains(c)) { continue; }
+      if(palette.count() == 256) { exact = false; break; }
+      lookup.insert(c, palette.count());
+      palette.append(c);
+    }
+  }
+
+  SeColorQuantizer quantizer(256);
+  if(exact == false)
+  {
+    palette = quantizer.build(sub);
+  }
+
+  int bits = 1;
+  while((1 << bits) < palette.count()) { bits++; }
+
+  QVector<quint8> indices;
+  indices.reserve(sub.width() * sub.height());
+  for(int y=0; y < sub.height(); y++)
+  {
+    const QRgb *line = reinterpret_cast<const QRgb*>(sub.constScanLine(y));
+    for(int x=0; x < sub.width(); x++)
+    {
+      if(exact) { indices.append((quint8) lookup.value(line[x] | 0xff000000)); }
+      else { indices.append((quint8) quantizer.indexOf(line[x])); }
+    }
+  }
+
+  // delay in 1/100 s, the remainder goes to the next frame
+  int total = msec + mDelayError;
+  int centiseconds = qMin(total / 10, 0xffff);
+  mDelayError = total - centiseconds * 10;
+
+  // graphic control extension, frames are drawn over the previous one
+  out.append((char) 0x21);
+  out.append((char) 0xf9);
+  out.append((char) 0x04);
+  out.append((char) 0x04);
+  appendU16LE(out, centiseconds);
+  out.append((char) 0x00);
+  out.append((char) 0x00);
+
+  // image descriptor with local color table
+  out.append((char) 0x2c);
+  appendU16LE(out, rect.x());
+  appendU16LE(out, rect.y());
+  appendU16LE(out, rect.width());
+  appendU16LE(out, rect.height());
+  out.append((char) (0x80 | (bits - 1)));
+
+  for(int i=0; i < (1 << bits); i++)
+  {
+    QRgb c = i < palette.count() ? palette.at(i) : 0;
+    out.append((char) qRed(c));
+    out.append((char) qGreen(c));
+    out.append((char) qBlue(c));
+  }
+
+  int minCodeSize = qMax(2, bits);
+  out.append((char) minCodeSize);
+  writeLzw(out, indices, minCodeSize);
+}
+
+void SeGifWriter::writeTrailer(QByteArray & out)
+{
+  out.append((char) 0x3b);
+}
+
+void SeGifWriter::writeLzw(QByteArray & out, const QVector<quint8> & indices, int minCodeSize)
+{
+  const int clearCode = 1 << minCodeSize;
+
+  SeGifBitWriter writer(out);
+
+  // (prefix code << 8 | next index) -> code
+  QHash<quint32, int> dictionary;
+
+  int codeSize = minCodeSize + 1;
+  int maxCode = clearCode + 1;
+  int current = -1;
+
+  writer.write(clearCode, codeSize);
+
+  for(quint8 next : indices)
+  {
+    if(current < 0)
+    {
+      current = next;
+      continue;
+    }
+
+    quint32 key = ((quint32) current << 8) | next;
+    auto it = dictionary.constFind(key);
+    if(it != dictionary.constEnd())
+    {
+      current = it.value();
+      continue;
+    }
+
+    writer.write(current, codeSize);
+
+    dictionary.insert(key, ++maxCode);
+    if(maxCode >= (1 << codeSize)) { codeSize++; }
+
+    if(maxCode == 4095)
+    {
+      writer.write(clearCode, codeSize);
+      dictionary.clear();
+      codeSize = minCodeSize + 1;
+      maxCode = clearCode + 1;
+    }
+
+    current = next;
+  }
+
+  if(current >= 0) { writer.write(current, codeSize); }
+  writer.write(clearCode, codeSize);
+  writer.write(clearCode + 1, minCodeSize + 1);
+
+  writer.finish();
+}
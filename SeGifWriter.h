@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SEGIFWRITER_H__
+#define __SEGIFWRITER_H__
+
+// SceneEditor
+#include <SeAnimationWriter.h>
+
+// Qt
+#include <QVector>
+
+/**
+ * @brief The SeGifWriter class
+ *
+ * Writes a looping GIF89a animation. Each frame only covers the 
+ * rectangle which changed and carries its own color table, frames 
+ * with more than 256 colors are reduced by SeColorQuantizer. Delays
+ * are stored in 1/100 s, the rounding error is carried over to the
+ * next frame so the total duration stays exact.
+ */
+class SeGifWriter
+  : public SeAnimationWriter
+{
+public:
+  explicit SeGifWriter(const QString & filename);
+
+protected:
+  void writeHeader(QByteArray & out, const QSize & size);
+  void writeFrame(QByteArray & out, const QImage & image, const QRect & rect, int msec);
+  void writeTrailer(QByteArray & out);
+
+private:
+  int mDelayError;
+
+  static void writeLzw(QByteArray & out, const QVector<quint8> & indices, int minCodeSize);
+};
+
+#endif // __SEGIFWRITER_H__
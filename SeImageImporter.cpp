@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeImageImporter.h>
+
+// Qt
+#include <QDir>
+#include <QCollator>
+#include <QEventLoop>
+#include <QImageReader>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+// C++
+#include <algorithm>
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+namespace {
+
+  //! Decodes and filters one file on a pool thread.
+  struct SeImageImportJob
+  {
+    typedef SeImportedImage result_type;
+
+    SeMosaicSettings settings;
+
+    SeImportedImage operator()(const QString & filename) const
+    {
+      SeImportedImage result;
+      result.filename = filename;
+      result.image = QImage(filename);
+      if(result.image.isNull() == false)
+      {
+        result.grid = settings.grid(result.image);
+      }
+      return result;
+    }
+  };
+
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeImageImporter::SeImageImporter(QObject *parent)
+  : QObject(parent)
+{
+}
+
+bool SeImageImporter::import(const QStringList & filenames)
+{
+  mImages.clear();
+
+  if(filenames.isEmpty()) { return false; }
+
+  SeImageImportJob job;
+  job.settings = mSettings;
+
+  QFutureWatcher<SeImportedImage> watcher;
+  QEventLoop loop;
+
+  QObject::connect(&watcher, &QFutureWatcherBase::progressValueChanged, [&](int done) {
+    emit progress(done, filenames.count());
+  });
+  QObject::connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+
+  watcher.setFuture(QtConcurrent::mapped(filenames, job));
+  if(watcher.isFinished() == false)
+  {
+    loop.exec();
+  }
+
+  for(const SeImportedImage & img : watcher.future().results())
+  {
+    if(img.grid.isNull()) { continue; }
+    mImages.append(img);
+  }
+
+  return mImages.isEmpty() == false;
+}
+
+QStringList SeImageImporter::imageFiles(const QString & directory)
+{
+  QStringList nameFilters;
+  for(const QByteArray & format : QImageReader::supportedImageFormats())
+  {
+    nameFilters << QString("*.%1").arg(QString::fromLatin1(format));
+  }
+
+  QDir dir(directory);
+  QStringList files = dir.entryList(nameFilters, QDir::Files | QDir::Readable);
+
+  QCollator collator;
+  collator.setNumericMode(true);
+  collator.setCaseSensitivity(Qt::CaseInsensitive);
+  std::sort(files.begin(), files.end(), [&](const QString & a, const QString & b) {
+    return collator.compare(a, b) < 0;
+  });
+
+  for(QString & f : files)
+  {
+    f = dir.absoluteFilePath(f);
+  }
+
+  return files;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SEIMAGEIMPORTER_H__
+#define __SEIMAGEIMPORTER_H__
+
+// SceneEditor
+#include <SeMosaicFilter.h>
+
+// Qt
+#include <QList>
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The SeImportedImage struct
+ */
+struct SeImportedImage
+{
+  QString filename;
+  //! The decoded image, becomes the original pixmap of the layer.
+  QImage image;
+  //! One color per LED.
+  QImage grid;
+};
+
+/**
+ * @brief The SeImageImporter class
+ *
+ * Decodes a list of image files and reduces each one to an LED grid
+ * with the same mosaic settings. Decoding and filtering run on the
+ * global thread pool, only the creation of the layers is left to the
+ * caller on the GUI thread.
+ */
+class SeImageImporter
+  : public QObject
+{
+  Q_OBJECT
+public:
+  explicit SeImageImporter(QObject *parent=0);
+
+  void setSettings(const SeMosaicSettings & settings) { mSettings = settings; }
+  const SeMosaicSettings & settings() const { return mSettings; }
+
+  //! Processes \p filenames, blocks until all images are done while
+  //! the event loop keeps running. Unreadable files are skipped.
+  //! \return False if not a single image could be imported.
+  bool import(const QStringList & filenames);
+
+  //! \return The images in the order of the given filenames.
+  const QList<SeImportedImage> & images() const { return mImages; }
+
+  //! \return The readable images of \p directory in natural order,
+  //!         i.e. frame2.png before frame10.png.
+  static QStringList imageFiles(const QString & directory);
+
+signals:
+  void progress(int done, int total);
+
+private:
+  SeMosaicSettings mSettings;
+  QList<SeImportedImage> mImages;
+};
+
+#endif // __SEIMAGEIMPORTER_H__
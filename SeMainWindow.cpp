@@ -8,16 +8,18 @@
 #include <QFile>
 #include <QImage>
 #include <QDebug>
+#include <QLabel>
 #include <QLayout>
 #include <QFileInfo>
 #include <QSettings>
+#include <QApplication>
 #include <QMessageBox>
 #include <QHBoxLayout>
 #include <QFileDialog>
 #include <QColorDialog>
 #include <QInputDialog>
+#include <QUuid>
 #include <QtWebSockets/QtWebSockets>
-#include <QTreeWidgetItemIterator>
 
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -31,6 +33,11 @@
 #include <SeSceneView.h>
 #include <SeSceneLayer.h>
 #include <SeTreeScenes.h>
+#include <SeAvrBinary.h>
+#include <SeAvrHeader.h>
+#include <SeVideoImporter.h>
+#include <SeImageImporter.h>
+#include <SeThumbnailCache.h>
 #include <SeMainWindow.h>
 #include <ui_SeMainWindow.h>
 
@@ -74,6 +81,17 @@ SeMainWindow::SeMainWindow(QWidget *parent)
     mpScene = mpSceneView->seScene();
     
     QObject::connect(mpScene, SIGNAL(item(SeSceneItem*)), this, SLOT(sceneItemClicked(SeSceneItem*)));
+
+    QLabel *repaintCost = new QLabel(this);
+    this->statusBar()->addPermanentWidget(repaintCost);
+    QObject::connect(mpSceneView, &SeSceneView::repaintCost, [repaintCost](double msec, int pixels) {
+      repaintCost->setText(tr("Repaint: %1 ms, %2 px").arg(msec, 0, 'f', 2).arg(pixels));
+    });
+
+    ui->treeScenes->setThumbnailCache(new SeThumbnailCache(mpScene, this));
+
+    QSettings s("settings.ini", QSettings::IniFormat);
+    ui->actionPartial_Repaint->setChecked(s.value("View/PartialRepaint", false).toBool());
   }
   
   mpScenePlayer = new SeScenePlayer(mpScene);
@@ -288,8 +306,6 @@ void SeMainWindow::applyPixmap(const QPixmap &pix)
         mpCurrentLayer->sceneItem(ix, iy)->properties().setBrushColor(rgb);
       }
     }
-    
-    mpCurrentLayer->update();  
   }
 }
 
@@ -317,7 +333,7 @@ void SeMainWindow::loadConfiguration(const QString &filename)
     QJsonDocument doc = QJsonDocument::fromJson(fileContent.toLocal8Bit());
     QJsonArray ar = doc.array();
     
-    SeTreeSceneItem *firstTreeItem = NULL;
+    QString firstIdentifier;
     
     for(int i=0; i < ar.count(); i++)
     {
@@ -336,17 +352,14 @@ void SeMainWindow::loadConfiguration(const QString &filename)
       p->properties().restore(o["Properties"].toObject());
       p->loadJson(o);      
       
-      SeTreeSceneItem *pp = ui->treeScenes->addScene(identifier, false);
-      if(firstTreeItem == NULL)
+      ui->treeScenes->addScene(identifier, false);
+      if(firstIdentifier.isEmpty())
       {
-        firstTreeItem = pp;
+        firstIdentifier = identifier;
       }
     }
     
-    ui->treeScenes->setCurrentItem(firstTreeItem);
-    emit ui->treeScenes->sceneLayerClicked(
-      firstTreeItem->data(0, SeTreeSceneItem::Roles::Uuid).toString()
-    );
+    ui->treeScenes->setCurrentScene(firstIdentifier);
   }
   
   SceneEditor::__statusBar->clearMessage();
@@ -421,7 +434,7 @@ void SeMainWindow::sceneLayerClicked(const QString &identifier)
   SeTreeScenes *p = ui->treeScenes;
   if(p != NULL)
   {
-    bool r = p->topLevelItem(0) != NULL;
+    bool r = p->count() > 0;
     
     ui->cmdGenerateVideo->setEnabled(r);
     ui->cmdDeployWebSocket->setEnabled(r);
@@ -579,8 +592,38 @@ void SeMainWindow::on_cmdGenerateVideo_clicked()
     
   videoTarget += QString("%1-Scene.mp4").arg(dt.toString("dd-MM-yyyy hh-mm"));
 
+  QSettings s("settings.ini", QSettings::IniFormat);
+  s.beginGroup("Export");
+  int fps = s.value("FrameRate", 1000 / mpScenePlayer->msecDelay()).toInt();
+  bool pingPong = s.value("PingPong", true).toBool();
+  s.endGroup();
+
+  bool ok = true;
+  fps = QInputDialog::getInt(this
+      , tr("Video export")
+      , tr("Frames per second:")
+      , fps, 1, 120, 1, &ok
+      );
+  if(ok == false) { return; }
+
+  QMessageBox::StandardButton answer = QMessageBox::question(this
+      , tr("Video export")
+      , tr("Play the scene backward after its end?")
+      , QMessageBox::Yes | QMessageBox::No
+      , pingPong ? QMessageBox::Yes : QMessageBox::No
+      );
+  pingPong = answer == QMessageBox::Yes;
+
+  s.beginGroup("Export");
+  s.setValue("FrameRate", fps);
+  s.setValue("PingPong", pingPong);
+  s.endGroup();
+  s.sync();
+
   mpScenePlayer->reset();
   mpScenePlayer->setLayers(layers);
+  mpScenePlayer->setExportFrameRate(fps);
+  mpScenePlayer->setExportPingPong(pingPong);
   mpScenePlayer->generateVideo(videoTarget);
 }
 
@@ -726,6 +769,18 @@ void SeMainWindow::on_cmdDeployWebSocket_clicked()
         });
         QObject::connect(mpWebSocket, &SeWebSocket::closed, [=](){
             qDebug() << "Disconnected!";
+
+            const SeWebSocketStats & stats = mpWebSocket->stats();
+            qDebug() << QString("Deployment: connect %1 ms, first ack %2 ms, %3 msg/s, %4 bytes/s")
+                .arg(stats.connectMsec())
+                .arg(stats.firstAckMsec())
+                .arg(stats.messagesPerSecond(), 0, 'f', 1)
+                .arg(stats.bytesPerSecond(), 0, 'f', 1);
+            if(stats.dump("websocket-stats.json") == false)
+            {
+                qDebug() << "Can not write WebSocket statistics!";
+            }
+
             mpLoading->stop();
             ui->cmdDeployWebSocket->setIcon(QIcon(":/Images/websocket0.png"));
         });
@@ -778,21 +833,107 @@ void SeMainWindow::on_cmdDeploy_clicked()
       {
         QTextStream s(&fcsv);
 
-        for(SeSceneLayer *player : layers)
+        for(int i=0; i < layers.count(); i++)
         {      
+          SeSceneLayer *player = layers.at(i);
           SE_CONT4NULL(player);
           
-          s << player->toAvrCsv();
-          #ifdef WIN32
-            s << "\r\n";
-          #else
-            s << "\n";
-          #endif
+          // the CSV format has no timing, held frames are repeated
+          QString line = player->toAvrCsv();
+          for(int h=0; h < mpScenePlayer->transitions()->hold(i); h++)
+          {
+            s << line;
+            #ifdef WIN32
+              s << "\r\n";
+            #else
+              s << "\n";
+            #endif
+          }
         }
       
         fcsv.close();
       }
+
+      // compact binary variant of the same frames
+      SeSceneLayer *firstLayer = layers.isEmpty() ? NULL : layers.first();
+      if(firstLayer != NULL)
+      {
+        SeAvrBinary avrBinary(firstLayer->numberOfRows(), firstLayer->numberOfColumns());
+        for(int i=0; i < layers.count(); i++)
+        {
+          avrBinary.addFrame(layers.at(i), mpScenePlayer->transitions()->hold(i));
+        }
+
+        QByteArray avrData = avrBinary.encode();
+
+        if(avrBinary.verify(avrData) == false)
+        {
+          QMessageBox::critical(
+                this
+              , tr("Binary deployment failed!")
+              , tr("The binary deployment data can not be decoded again.")
+            );
+        }
+        else
+        {
+          QString binFilename = QString("%1/%2.bin")
+            .arg(mDeploymentDirname)
+            .arg(info.baseName());
+
+          QFile fbin(binFilename);
+          if(fbin.open(QIODevice::WriteOnly | QIODevice::Truncate))
+          {
+            fbin.write(avrData);
+            fbin.close();
+          }
+
+          SceneEditor::__statusBar->showMessage(tr("Binary deployment: %1 bytes, %2 colors, %3 frames")
+            .arg(avrData.size())
+            .arg(avrBinary.palette().count())
+            .arg(avrBinary.numberOfFrames()));
+        }
+        
+        // ready-to-compile C header
+        SeScenePlayerTransitions *transitions = mpScenePlayer->transitions();
+        
+        SeAvrHeader avrHeader(info.baseName(), firstLayer->numberOfRows(), firstLayer->numberOfColumns());
+        for(int i=0; i < layers.count(); i++)
+        {
+          avrHeader.addFrame(layers.at(i), transitions->duration(i));
+        }
+        for(int i=0; i < transitions->sourceLayers().count(); i++)
+        {
+          avrHeader.addLayer(transitions->sourceLayers().at(i)->delay(), transitions->firstFrames().at(i));
+        }
+        
+        QString headerContent = avrHeader.generate();
+        
+        if(avrHeader.verify() == false)
+        {
+          QMessageBox::critical(
+                this
+              , tr("Header deployment failed!")
+              , tr("The generated frame tables can not be decoded again.")
+            );
+        }
+        else
+        {
+          QString headerFilename = QString("%1/%2.h")
+            .arg(mDeploymentDirname)
+            .arg(info.baseName());
             
+          QFile fheader(headerFilename);
+          if(fheader.open(QIODevice::WriteOnly | QIODevice::Truncate))
+          {
+            QTextStream s(&fheader);
+            s << headerContent;
+            fheader.close();
+            
+            mDeploymentFilename = headerFilename;
+          }
+        }
+      }
+
       QStringList apps;
       int r = -1;
       
@@ -906,6 +1047,9 @@ void SeMainWindow::on_cmdModifyImage_clicked()
     QPoint offset = mpCurrentLayer->properties().offset();        
     mpMosaicWindow->setOffset(offset); 
     
+    // Mode
+    mpMosaicWindow->setMosaicMode((SeMosaicWindow::MosaicMode) mpCurrentLayer->properties().mosaicMode());
+    
     // Selection Frame    
     QRect r = mpCurrentLayer->properties().selectionGeometry();
     if(r.isEmpty() || r.isEmpty() || r.isNull())
@@ -933,6 +1077,7 @@ void SeMainWindow::on_cmdModifyImage_clicked()
       mpCurrentLayer->properties().setOffset(offset);
       mpCurrentLayer->properties().setSelectionGeometry(selectionRect);
       mpCurrentLayer->properties().setScale(scaleValue);
+      mpCurrentLayer->properties().setMosaicMode(mpMosaicWindow->mosaicMode());
     }
   }
 }
@@ -979,7 +1124,7 @@ void SeMainWindow::on_actionSave_As_triggered()
 void SeMainWindow::on_actionNew_triggered()
 {
   bool res = this->closeProject();
-  SeTreeSceneItem::resetInstanceCounter();
+  ui->treeScenes->sceneModel()->resetInstanceCounter();
   Q_UNUSED(res);
 }
 
@@ -1074,8 +1219,6 @@ void SeMainWindow::on_cmdChangeColor_2_clicked()
     pled->properties().setBrushColor(c);
     pled->properties().setPenColor(c);
   }
-  
-  mpScene->update();
 }
 
 void SeMainWindow::on_actionAbout_Qt_triggered()
@@ -1147,3 +1290,229 @@ void SeMainWindow::on_actionAbout_SceneEditor_triggered()
         );
 }
 
+void SeMainWindow::on_actionImport_Video_triggered()
+{
+  if(mpScene == NULL) { return; }
+  
+  QString videoFilename = QFileDialog::getOpenFileName(
+                              this
+                            , tr("Select video for import...")
+                            , QString()
+                            , tr("Videos (*.mp4 *.avi *.mov *.mkv *.webm *.gif);;All files (*)")
+                           );
+  if(videoFilename.isEmpty()) { return; }
+  
+  SeVideoImporter importer;
+  importer.setGridSize(DEFAULT_COLUMNS, DEFAULT_ROWS);
+  importer.setFilter(SeMosaicFilter(mpMosaicWindow->mosaicMode(), SeMosaicWindow::pixelSteps()));
+  // more frames than player steps would be dropped during playback
+  importer.setMaxFrameRate(1000.0 / qMax(1, mpScenePlayer->msecDelay()));
+  
+  QObject::connect(&importer, &SeVideoImporter::progress, [&](int frames) {
+    SceneEditor::__statusBar->showMessage(tr("Importing video: %1 frames decoded").arg(frames));
+  });
+  
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  bool res = importer.import(videoFilename);
+  QApplication::restoreOverrideCursor();
+  
+  if(res == false)
+  {
+    SceneEditor::__statusBar->clearMessage();
+    
+    QMessageBox::critical(
+        this
+      , tr("Video import failed!")
+      , importer.errorString()
+     );
+     
+    return;
+  }
+  
+  const QList<QImage> & frames = importer.frames();
+  const double delay = 1.0 / importer.frameRate();
+  
+  QString firstIdentifier;
+  
+  for(int i=0; i < frames.count(); i++)
+  {
+    const QImage & grid = frames.at(i);
+    
+    QString identifier = QUuid::createUuid().toString();
+    
+    SeSceneLayer *p = this->createScene(identifier);
+    SE_CONT4NULL(p);
+    p->setDelay(delay);
+    
+    int w = qMin(p->numberOfColumns(), grid.width());
+    int h = qMin(p->numberOfRows(), grid.height());
+    
+    for(int iy=0; iy < h; iy++)
+    {
+      const QRgb *line = reinterpret_cast<const QRgb*>(grid.constScanLine(iy));
+      for(int ix=0; ix < w; ix++)
+      {
+        p->sceneItem(ix, iy)->properties().setBrushColor(line[ix]);
+      }
+    }
+    
+    ui->treeScenes->addScene(identifier, false);
+    if(firstIdentifier.isEmpty())
+    {
+      firstIdentifier = identifier;
+    }
+  }
+  
+  if(firstIdentifier.isEmpty() == false)
+  {
+    ui->treeScenes->setCurrentScene(firstIdentifier);
+  }
+  
+  SceneEditor::__statusBar->showMessage(
+    tr("Imported %1 frames at %2 fps").arg(frames.count()).arg(importer.frameRate(), 0, 'f', 2));
+  
+  mpScene->update();
+}
+
+void SeMainWindow::on_actionImport_Image_Folder_triggered()
+{
+  if(mpScene == NULL) { return; }
+  
+  QString directory = QFileDialog::getExistingDirectory(this, tr("Select image folder for import..."));
+  if(directory.isEmpty()) { return; }
+  
+  QStringList files = SeImageImporter::imageFiles(directory);
+  if(files.isEmpty())
+  {
+    QMessageBox::information(this, tr("No images!"), tr("The folder contains no readable images:\n%1").arg(directory));
+    return;
+  }
+  
+  // all images share the mosaic settings of the current layer
+  SeMosaicSettings settings;
+  settings.blockSize = SeMosaicWindow::pixelSteps();
+  settings.selectionGeometry = QRect(0, 0, DEFAULT_COLUMNS * settings.blockSize, DEFAULT_ROWS * settings.blockSize);
+  settings.offset = QPoint(SE_SCALE_PADDING, SE_SCALE_PADDING);
+  
+  if(mpCurrentLayer != NULL)
+  {
+    const SeSceneItemProperties & props = mpCurrentLayer->properties();
+    
+    if(props.selectionGeometry().isEmpty() == false)
+    {
+      settings.offset = props.offset();
+      settings.selectionGeometry = props.selectionGeometry();
+      settings.scale = props.scale();
+    }
+    settings.mode = (SeMosaicFilter::Mode) props.mosaicMode();
+  }
+  
+  SeImageImporter importer;
+  importer.setSettings(settings);
+  
+  QObject::connect(&importer, &SeImageImporter::progress, [&](int done, int total) {
+    SceneEditor::__statusBar->showMessage(tr("Importing images: %1 of %2").arg(done).arg(total));
+  });
+  
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  bool res = importer.import(files);
+  QApplication::restoreOverrideCursor();
+  
+  if(res == false)
+  {
+    SceneEditor::__statusBar->clearMessage();
+    QMessageBox::critical(this, tr("Image import failed!"), tr("None of the images could be read."));
+    return;
+  }
+  
+  const double delay = ui->spinDelay->value();
+  
+  QString firstIdentifier;
+  
+  for(const SeImportedImage & img : importer.images())
+  {
+    QString identifier = QUuid::createUuid().toString();
+    
+    SeSceneLayer *p = this->createScene(identifier);
+    SE_CONT4NULL(p);
+    p->setDelay(delay);
+    
+    p->properties().setOriginalFilePath(img.filename);
+    p->properties().setOriginalPixmap(QPixmap::fromImage(img.image));
+    p->properties().setOffset(settings.offset);
+    p->properties().setSelectionGeometry(settings.selectionGeometry);
+    p->properties().setScale(settings.scale);
+    p->properties().setMosaicMode(settings.mode);
+    
+    int w = qMin(p->numberOfColumns(), img.grid.width());
+    int h = qMin(p->numberOfRows(), img.grid.height());
+    
+    for(int iy=0; iy < h; iy++)
+    {
+      const QRgb *line = reinterpret_cast<const QRgb*>(img.grid.constScanLine(iy));
+      for(int ix=0; ix < w; ix++)
+      {
+        p->sceneItem(ix, iy)->properties().setBrushColor(line[ix]);
+      }
+    }
+    
+    ui->treeScenes->addScene(identifier, false);
+    if(firstIdentifier.isEmpty())
+    {
+      firstIdentifier = identifier;
+    }
+  }
+  
+  if(firstIdentifier.isEmpty() == false)
+  {
+    ui->treeScenes->setCurrentScene(firstIdentifier);
+  }
+  
+  SceneEditor::__statusBar->showMessage(
+    tr("Imported %1 of %2 images").arg(importer.images().count()).arg(files.count()));
+  
+  mpScene->update();
+}
+
+void SeMainWindow::on_actionExport_Animation_triggered()
+{
+  QList<SeSceneLayer*> layers;
+  
+  int n = this->initializeLayersForPlayer(layers);
+  if(n < 0) { return; }
+  
+  QString target = QDir::homePath();
+  if(target[target.length()-1] != '/') { target += "/"; }
+  
+  target += QString("Exports/%1-Scene.gif").arg(QDateTime::currentDateTime().toString("dd-MM-yyyy hh-mm"));
+  
+  QString filename = QFileDialog::getSaveFileName(
+                         this
+                       , tr("Export animation...")
+                       , target
+                       , tr("Animated GIF (*.gif);;Animated PNG (*.png *.apng)")
+                      );
+  if(filename.isEmpty()) { return; }
+  
+  mpScenePlayer->reset();
+  mpScenePlayer->setLayers(layers);
+  
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  bool res = mpScenePlayer->generateAnimation(filename);
+  QApplication::restoreOverrideCursor();
+  
+  if(res == false)
+  {
+    QMessageBox::critical(this, tr("Export failed!"), tr("The animation could not be written:\n%1").arg(filename));
+  }
+}
+
+void SeMainWindow::on_actionPartial_Repaint_toggled(bool checked)
+{
+  if(mpSceneView == NULL) { return; }
+
+  mpSceneView->setRenderMode(checked ? SeSceneView::PartialRepaint : SeSceneView::FullRepaint);
+
+  QSettings s("settings.ini", QSettings::IniFormat);
+  s.setValue("View/PartialRepaint", checked);
+}
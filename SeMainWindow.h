@@ -118,6 +118,10 @@ private slots:
   void on_cmdDeploy_clicked();
   void on_actionAbout_SceneEditor_triggered();
   void on_cmdDeployWebSocket_clicked();
+  void on_actionImport_Video_triggered();
+  void on_actionImport_Image_Folder_triggered();
+  void on_actionExport_Animation_triggered();
+  void on_actionPartial_Repaint_toggled(bool checked);
 };
 
 #endif // __SEMAINWINDOW_H__
@@ -0,0 +1,516 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeMosaicFilter.h>
+
+// Qt
+#include <QtMath>
+
+// C++
+#include <cstring>
+#include <algorithm>
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeIntegralImage::SeIntegralImage()
+  : mWidth(0)
+  , mHeight(0)
+{
+}
+
+SeIntegralImage::SeIntegralImage(const QImage & image)
+  : mWidth(0)
+  , mHeight(0)
+{
+  this->build(image);
+}
+
+void SeIntegralImage::build(const QImage & source)
+{
+  QImage image = source;
+  if(image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32)
+  {
+    image = source.convertToFormat(QImage::Format_RGB32);
+  }
+
+  mWidth = image.width();
+  mHeight = image.height();
+  
+  const size_t stride = (size_t) (mWidth + 1) * 3;
+  mSums.assign(stride * (mHeight + 1), 0);
+  
+  for(int y=0; y < mHeight; y++)
+  {
+    const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+    const quint32 *above = &mSums[(size_t) y * stride];
+    quint32 *current = &mSums[(size_t) (y + 1) * stride];
+    
+    quint32 r = 0, g = 0, b = 0;
+    for(int x=0; x < mWidth; x++)
+    {
+      r += qRed(line[x]);
+      g += qGreen(line[x]);
+      b += qBlue(line[x]);
+      
+      size_t i = (size_t) (x + 1) * 3;
+      current[i]     = above[i]     + r;
+      current[i + 1] = above[i + 1] + g;
+      current[i + 2] = above[i + 2] + b;
+    }
+  }
+}
+
+QRgb SeIntegralImage::mean(int x0, int y0, int x1, int y1) const
+{
+  x0 = qBound(0, x0, mWidth);
+  x1 = qBound(0, x1, mWidth);
+  y0 = qBound(0, y0, mHeight);
+  y1 = qBound(0, y1, mHeight);
+  
+  quint32 n = (quint32) ((x1 - x0) * (y1 - y0));
+  if(n == 0) { return qRgb(255, 255, 255); }
+  
+  const quint32 *a = this->at(x0, y0);
+  const quint32 *b = this->at(x1, y0);
+  const quint32 *c = this->at(x0, y1);
+  const quint32 *d = this->at(x1, y1);
+  
+  quint32 red   = d[0] - b[0] - c[0] + a[0];
+  quint32 green = d[1] - b[1] - c[1] + a[1];
+  quint32 blue  = d[2] - b[2] - c[2] + a[2];
+  
+  return qRgb(red / n, green / n, blue / n);
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+static const int BayerMatrix[64] = {
+   0, 32,  8, 40,  2, 34, 10, 42,
+  48, 16, 56, 24, 50, 18, 58, 26,
+  12, 44,  4, 36, 14, 46,  6, 38,
+  60, 28, 52, 20, 62, 30, 54, 22,
+   3, 35, 11, 43,  1, 33,  9, 41,
+  51, 19, 59, 27, 49, 17, 57, 25,
+  15, 47,  7, 39, 13, 45,  5, 37,
+  63, 31, 55, 23, 61, 29, 53, 21
+};
+
+SeDither::SeDither(Mode mode, int bitDepth)
+  : mMode(mode)
+  , mBitDepth(0)
+{
+  this->setBitDepth(bitDepth);
+}
+
+void SeDither::setBitDepth(int bits)
+{
+  bits = qBound(1, bits, 8);
+  if(bits == mBitDepth) { return; }
+  
+  mBitDepth = bits;
+  
+  const int levels = (1 << bits) - 1;
+  for(int v=0; v < 256; v++)
+  {
+    mLevels[v] = (uchar) (((v * levels + 127) / 255) * 255 / levels);
+  }
+  
+  // the threshold moves a value by up to half a quantization step
+  const float step = 255.f / levels;
+  mBayerLut.resize(64 * 256);
+  for(int cell=0; cell < 64; cell++)
+  {
+    float offset = ((BayerMatrix[cell] + 0.5f) / 64.f - 0.5f);
+    mBayerOffset[cell] = qRound(offset * 32.f);
+    for(int v=0; v < 256; v++)
+    {
+      mBayerLut[cell * 256 + v] = mLevels[qBound(0, qRound(v + offset * step), 255)];
+    }
+  }
+}
+
+void SeDither::apply(QImage & image, const SeColorQuantizer *pquantizer)
+{
+  if(image.isNull() || mMode == NoDither) { return; }
+  
+  // nothing to spread without a palette and with full 8 bit
+  if(pquantizer == NULL && mBitDepth == 8) { return; }
+  
+  if(image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32)
+  {
+    image = image.convertToFormat(QImage::Format_RGB32);
+  }
+  
+  if(mMode == FloydSteinberg) { this->floydSteinberg(image, pquantizer); }
+  else if(mMode == Bayer) { this->bayer(image, pquantizer); }
+}
+
+void SeDither::floydSteinberg(QImage & image, const SeColorQuantizer *pquantizer)
+{
+  const int w = image.width();
+  const int h = image.height();
+  
+  // error terms of the current and next line, one pixel padding per side
+  const int stride = (w + 2) * 3;
+  mErrors.assign(stride * 2, 0);
+  
+  for(int y=0; y < h; y++)
+  {
+    int *current = &mErrors[(y & 1) * stride];
+    int *next = &mErrors[((y + 1) & 1) * stride];
+    std::fill(next, next + stride, 0);
+    
+    QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+    
+    for(int x=0; x < w; x++)
+    {
+      const int i = (x + 1) * 3;
+      
+      // errors are stored in 1/16 units
+      int r = qBound(0, qRed(line[x])   + current[i]     / 16, 255);
+      int g = qBound(0, qGreen(line[x]) + current[i + 1] / 16, 255);
+      int b = qBound(0, qBlue(line[x])  + current[i + 2] / 16, 255);
+      
+      QRgb q;
+      if(pquantizer != NULL) { q = pquantizer->map(qRgb(r, g, b)); }
+      else { q = qRgb(mLevels[r], mLevels[g], mLevels[b]); }
+      
+      line[x] = q;
+      
+      const int e[3] = { r - qRed(q), g - qGreen(q), b - qBlue(q) };
+      for(int c=0; c < 3; c++)
+      {
+        current[i + 3 + c] += e[c] * 7;
+        next[i - 3 + c]    += e[c] * 3;
+        next[i + c]        += e[c] * 5;
+        next[i + 3 + c]    += e[c];
+      }
+    }
+  }
+}
+
+void SeDither::bayer(QImage & image, const SeColorQuantizer *pquantizer)
+{
+  const int w = image.width();
+  const int h = image.height();
+  
+  for(int y=0; y < h; y++)
+  {
+    QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+    const int row = (y & 7) * 8;
+    
+    if(pquantizer != NULL)
+    {
+      for(int x=0; x < w; x++)
+      {
+        const int offset = mBayerOffset[row + (x & 7)];
+        line[x] = pquantizer->map(qRgb( qBound(0, qRed(line[x]) + offset, 255)
+                                      , qBound(0, qGreen(line[x]) + offset, 255)
+                                      , qBound(0, qBlue(line[x]) + offset, 255)));
+      }
+    }
+    else
+    {
+      for(int x=0; x < w; x++)
+      {
+        const uchar *lut = &mBayerLut[(row + (x & 7)) * 256];
+        line[x] = qRgb(lut[qRed(line[x])], lut[qGreen(line[x])], lut[qBlue(line[x])]);
+      }
+    }
+  }
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeMosaicFilter::SeMosaicFilter(Mode mode, int blockSize)
+  : mMode(mode)
+  , mBlockSize(0)
+  , mpCurrentGeneration(NULL)
+  , mGeneration(0)
+{
+  this->setBlockSize(blockSize);
+}
+
+void SeMosaicFilter::setCancelCheck(const QAtomicInt *pcurrentGeneration, int generation)
+{
+  mpCurrentGeneration = pcurrentGeneration;
+  mGeneration = generation;
+}
+
+bool SeMosaicFilter::isCancelled() const
+{
+  if(mpCurrentGeneration == NULL) { return false; }
+  
+  return mpCurrentGeneration->loadAcquire() != mGeneration;
+}
+
+void SeMosaicFilter::setBlockSize(int blockSize)
+{
+  mBlockSize = qMax(1, blockSize);
+  
+  size_t n = (size_t) mBlockSize * (size_t) mBlockSize;
+  mRed.resize(n);
+  mGreen.resize(n);
+  mBlue.resize(n);
+}
+
+QImage SeMosaicFilter::toRgb32(const QImage & image)
+{
+  if(image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32)
+  {
+    return image;
+  }
+  
+  return image.convertToFormat(QImage::Format_RGB32);
+}
+
+QRgb SeMosaicFilter::block(const QImage & image, int x, int y)
+{
+  if(image.isNull()) { return qRgb(255, 255, 255); }
+  if(x < 0 || y < 0 || x >= image.width() || y >= image.height()) { return qRgb(255, 255, 255); }
+  
+  return this->blockRgb32(toRgb32(image), x, y);
+}
+
+QRgb SeMosaicFilter::blockRgb32(const QImage & image, int x, int y)
+{
+  const int x1 = qMin(x + mBlockSize, image.width());
+  const int y1 = qMin(y + mBlockSize, image.height());
+  
+  switch(mMode)
+  {
+    case Average:
+    case Palette:
+    {
+      int r = 0, g = 0, b = 0;
+      for(int iy=y; iy < y1; iy++)
+      {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(iy));
+        for(int ix=x; ix < x1; ix++)
+        {
+          r += qRed(line[ix]);
+          g += qGreen(line[ix]);
+          b += qBlue(line[ix]);
+        }
+      }
+      int n = (x1 - x) * (y1 - y);
+      return qRgb(r / n, g / n, b / n);
+    }
+    
+    case Minimum:
+    case Maximum:
+    {
+      const bool isMin = mMode == Minimum;
+      int r = isMin ? 255 : 0;
+      int g = r;
+      int b = r;
+      for(int iy=y; iy < y1; iy++)
+      {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(iy));
+        for(int ix=x; ix < x1; ix++)
+        {
+          if(isMin)
+          {
+            r = qMin(r, qRed(line[ix]));
+            g = qMin(g, qGreen(line[ix]));
+            b = qMin(b, qBlue(line[ix]));
+          }
+          else
+          {
+            r = qMax(r, qRed(line[ix]));
+            g = qMax(g, qGreen(line[ix]));
+            b = qMax(b, qBlue(line[ix]));
+          }
+        }
+      }
+      return qRgb(r, g, b);
+    }
+    
+    case Median:
+    {
+      int n = 0;
+      for(int iy=y; iy < y1; iy++)
+      {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(iy));
+        for(int ix=x; ix < x1; ix++, n++)
+        {
+          mRed[n] = qRed(line[ix]);
+          mGreen[n] = qGreen(line[ix]);
+          mBlue[n] = qBlue(line[ix]);
+        }
+      }
+      
+      int m = n / 2;
+      std::nth_element(mRed.begin(), mRed.begin() + m, mRed.begin() + n);
+      std::nth_element(mGreen.begin(), mGreen.begin() + m, mGreen.begin() + n);
+      std::nth_element(mBlue.begin(), mBlue.begin() + m, mBlue.begin() + n);
+      
+      return qRgb(mRed[m], mGreen[m], mBlue[m]);
+    }
+  }
+  
+  return qRgb(255, 255, 255);
+}
+
+QImage SeMosaicFilter::grid(const QImage & source)
+{
+  if(source.isNull() || this->isCancelled()) { return QImage(); }
+
+  QImage img = toRgb32(source);
+  
+  int columns = (img.width() + mBlockSize - 1) / mBlockSize;
+  int rows = (img.height() + mBlockSize - 1) / mBlockSize;
+  
+  QImage result(columns, rows, QImage::Format_RGB32);
+  
+  if(mMode == Average || mMode == Palette)
+  {
+    SeIntegralImage integral(img);
+    
+    for(int row=0; row < rows; row++)
+    {
+      if(row % SE_MOSAIC_CANCEL_ROWS == 0 && this->isCancelled()) { return QImage(); }
+      
+      QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(row));
+      int y = row * mBlockSize;
+      for(int col=0; col < columns; col++)
+      {
+        int x = col * mBlockSize;
+        line[col] = integral.mean(x, y, x + mBlockSize, y + mBlockSize);
+      }
+    }
+  }
+  else
+  {
+    for(int row=0; row < rows; row++)
+    {
+      if(row % SE_MOSAIC_CANCEL_ROWS == 0 && this->isCancelled()) { return QImage(); }
+      
+      QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(row));
+      for(int col=0; col < columns; col++)
+      {
+        line[col] = this->blockRgb32(img, col * mBlockSize, row * mBlockSize);
+      }
+    }
+  }
+  
+  if(this->isCancelled()) { return QImage(); }
+  
+  if(mMode == Palette)
+  {
+    mQuantizer.build(result);
+    
+    if(this->isCancelled()) { return QImage(); }
+    
+    if(mDither.mode() == SeDither::NoDither) { return mQuantizer.apply(result); }
+    
+    mDither.apply(result, &mQuantizer);
+    return result;
+  }
+  
+  mDither.apply(result);
+  
+  return result;
+}
+
+QImage SeMosaicFilter::apply(const QImage & source)
+{
+  return expand(this->grid(source), mBlockSize, source.size());
+}
+
+QImage SeMosaicFilter::sample(const QImage & source, int blockSize)
+{
+  if(source.isNull() || blockSize <= 0) { return QImage(); }
+  
+  QImage img = toRgb32(source);
+  
+  int columns = (img.width() + blockSize - 1) / blockSize;
+  int rows = (img.height() + blockSize - 1) / blockSize;
+  
+  QImage result(columns, rows, QImage::Format_RGB32);
+  
+  for(int row=0; row < rows; row++)
+  {
+    int y = qMin(row * blockSize + blockSize / 2, img.height() - 1);
+    const QRgb *src = reinterpret_cast<const QRgb*>(img.constScanLine(y));
+    QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(row));
+    for(int col=0; col < columns; col++)
+    {
+      line[col] = src[qMin(col * blockSize + blockSize / 2, img.width() - 1)];
+    }
+  }
+  
+  return result;
+}
+
+QImage SeMosaicFilter::expand(const QImage & grid, int blockSize, const QSize & size)
+{
+  if(grid.isNull() || size.isEmpty()) { return QImage(); }
+
+  QImage src = toRgb32(grid);
+  QImage result(size, QImage::Format_RGB32);
+  
+  const int w = size.width();
+  const int h = size.height();
+  
+  for(int y=0; y < h; y += blockSize)
+  {
+    int row = qMin(y / blockSize, src.height() - 1);
+    const QRgb *gridLine = reinterpret_cast<const QRgb*>(src.constScanLine(row));
+    QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
+    
+    for(int x=0; x < w; x++)
+    {
+      line[x] = gridLine[qMin(x / blockSize, src.width() - 1)];
+    }
+    
+    // all other lines of the block are identical
+    int y1 = qMin(y + blockSize, h);
+    for(int iy=y + 1; iy < y1; iy++)
+    {
+      memcpy(result.scanLine(iy), line, w * sizeof(QRgb));
+    }
+  }
+  
+  return result;
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeMosaicSettings::SeMosaicSettings()
+  : offset(0, 0)
+  , scale(100)
+  , mode(SeMosaicFilter::Average)
+  , blockSize(PIXEL_FOR_STEP)
+{
+}
+
+QImage SeMosaicSettings::selection(const QImage & original) const
+{
+  if(original.isNull() || selectionGeometry.isEmpty()) { return QImage(); }
+  
+  const double factor = qMax(1, scale) / 100.0;
+  
+  // selection frame in coordinates of the scaled image shown by the dialog
+  QRect scaled = selectionGeometry.translated(offset - QPoint(SE_SCALE_PADDING, SE_SCALE_PADDING));
+  
+  // crop first, only the selected part is resampled
+  QRect source( qFloor(scaled.x() / factor)
+              , qFloor(scaled.y() / factor)
+              , qMax(1, qCeil(scaled.width() / factor))
+              , qMax(1, qCeil(scaled.height() / factor)));
+  
+  return original.copy(source).scaled( selectionGeometry.size()
+                                     , Qt::IgnoreAspectRatio
+                                     , Qt::SmoothTransformation);
+}
+
+QImage SeMosaicSettings::grid(const QImage & original) const
+{
+  SeMosaicFilter filter(mode, blockSize);
+  return filter.grid(this->selection(original));
+}
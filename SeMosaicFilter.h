@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SEMOSAICFILTER_H__
+#define __SEMOSAICFILTER_H__
+
+// SceneEditor
+#include <SeColorQuantizer.h>
+
+// Qt
+#include <QRgb>
+#include <QSize>
+#include <QRect>
+#include <QPoint>
+#include <QImage>
+#include <QAtomicInt>
+
+// C++
+#include <vector>
+
+#define PIXEL_FOR_STEP 5
+
+//! Number of grid rows between two checks for a cancelled grid().
+#define SE_MOSAIC_CANCEL_ROWS 16
+
+//! Transparent border around a scaled image in the mosaic dialog.
+#define SE_SCALE_PADDING 100
+
+/**
+ * @brief The SeIntegralImage class
+ *
+ * Summed-area table of the red, green and blue channel, the sum of 
+ * any rectangle costs four lookups. The sums use modular unsigned 
+ * arithmetic, rectangle sums are exact as long as they fit into 
+ * 32 bit, i.e. for blocks of up to 16 million pixels.
+ */
+class SeIntegralImage
+{
+public:
+  SeIntegralImage();
+  explicit SeIntegralImage(const QImage & image);
+  
+  void build(const QImage & image);
+  
+  int width() const { return mWidth; }
+  int height() const { return mHeight; }
+  
+  //! \return The mean color of the rectangle [x0, x1) x [y0, y1).
+  QRgb mean(int x0, int y0, int x1, int y1) const;
+  
+private:
+  int mWidth;
+  int mHeight;
+  
+  // (width + 1) * (height + 1) entries of interleaved r, g, b sums
+  std::vector<quint32> mSums;
+  
+  inline const quint32 *at(int x, int y) const {
+    return &mSums[((size_t) y * (mWidth + 1) + x) * 3];
+  }
+};
+
+/**
+ * @brief The SeDither class
+ *
+ * Reduces an image to bitDepth() bits per channel, or to the colors
+ * of a palette, while spreading the quantization error. Floyd-Steinberg
+ * keeps two scanlines of error terms, Bayer uses an 8x8 matrix with a 
+ * precomputed threshold lookup table per matrix cell.
+ */
+class SeDither
+{
+public:
+  enum Mode { NoDither=0, FloydSteinberg, Bayer };
+  
+  SeDither(Mode mode=NoDither, int bitDepth=8);
+  
+  void setMode(Mode mode) { mMode = mode; }
+  Mode mode() const { return mMode; }
+  
+  void setBitDepth(int bits);
+  int bitDepth() const { return mBitDepth; }
+  
+  //! Dithers \p image in place, if \p pquantizer is given its palette
+  //! is the target instead of the reduced bit depth.
+  void apply(QImage & image, const SeColorQuantizer *pquantizer=NULL);
+  
+private:
+  Mode mMode;
+  int mBitDepth;
+  
+  // channel value to the nearest value with mBitDepth bits
+  uchar mLevels[256];
+  // 64 matrix cells times 256 channel values
+  std::vector<uchar> mBayerLut;
+  // 64 matrix cells, threshold offset for the palette target
+  int mBayerOffset[64];
+  
+  std::vector<int> mErrors;
+  
+  void floydSteinberg(QImage & image, const SeColorQuantizer *pquantizer);
+  void bayer(QImage & image, const SeColorQuantizer *pquantizer);
+};
+
+/**
+ * @brief The SeMosaicFilter class
+ *
+ * Reduces an image block-wise, i.e. every block of blockSize() x
+ * blockSize() pixels results in one color. The filter works on the
+ * raw scanlines of 32-bit images, all buffers are allocated once
+ * per filter instance. Blocks at the right and bottom border are
+ * clipped to the image. The average of a whole grid is taken from
+ * a SeIntegralImage, so its cost does not depend on the block size.
+ * Palette averages the blocks and reduces the grid to an adaptive
+ * palette of paletteSize() colors. The grid is finally dithered 
+ * to bitDepth() bits per channel or to the palette.
+ */
+class SeMosaicFilter
+{
+public:
+  enum Mode { Average=0, Median, Minimum, Maximum, Palette };
+
+  SeMosaicFilter(Mode mode=Average, int blockSize=PIXEL_FOR_STEP);
+
+  void setMode(Mode mode) { mMode = mode; }
+  Mode mode() const { return mMode; }
+
+  void setBlockSize(int blockSize);
+  int blockSize() const { return mBlockSize; }
+
+  //! Number of colors of the adaptive palette used by Palette.
+  void setPaletteSize(int colors) { mQuantizer.setMaxColors(colors); }
+  int paletteSize() const { return mQuantizer.maxColors(); }
+
+  //! Dithering of the grid, see SeDither.
+  void setDither(SeDither::Mode mode) { mDither.setMode(mode); }
+  SeDither::Mode dither() const { return mDither.mode(); }
+  void setBitDepth(int bits) { mDither.setBitDepth(bits); }
+  int bitDepth() const { return mDither.bitDepth(); }
+
+  //! \return The palette of the last Palette grid.
+  const QVector<QRgb> & palette() const { return mQuantizer.palette(); }
+
+  //! \return The color of the block with the top-left pixel \p x, \p y.
+  QRgb block(const QImage & image, int x, int y);
+
+  //! Lets grid() give up as soon as \p *pcurrentGeneration differs 
+  //! from \p generation, e.g. for a preview superseded by new input.
+  void setCancelCheck(const QAtomicInt *pcurrentGeneration, int generation);
+  bool isCancelled() const;
+
+  //! \return One pixel per block, i.e. the image at LED-grid resolution,
+  //!         a null image if it was cancelled.
+  QImage grid(const QImage & source);
+
+  //! \return Image of the size of \p source where each block is 
+  //!         filled with its color.
+  QImage apply(const QImage & source);
+
+  //! \return One pixel per block taken from the block center, much 
+  //!         cheaper than grid() and used for a first rough preview.
+  static QImage sample(const QImage & source, int blockSize);
+
+  //! \return Scales \p grid up to \p size, one pixel becomes a block.
+  static QImage expand(const QImage & grid, int blockSize, const QSize & size);
+
+private:
+  Mode mMode;
+  int mBlockSize;
+
+  SeColorQuantizer mQuantizer;
+  SeDither mDither;
+
+  const QAtomicInt *mpCurrentGeneration;
+  int mGeneration;
+
+  // channel buffers used by the median selection
+  std::vector<uchar> mRed;
+  std::vector<uchar> mGreen;
+  std::vector<uchar> mBlue;
+  
+  static QImage toRgb32(const QImage & image);
+  QRgb blockRgb32(const QImage & image, int x, int y);
+};
+
+/**
+ * @brief The SeMosaicSettings struct
+ *
+ * Mosaic settings of a layer as chosen in the mosaic dialog, i.e. the
+ * image offset, selection frame and scale in percent. selection() 
+ * returns the pixels below the selection frame without the dialog,
+ * e.g. to apply the settings of one layer to many images.
+ */
+struct SeMosaicSettings
+{
+  SeMosaicSettings();
+  
+  QPoint offset;
+  QRect selectionGeometry;
+  int scale;
+  SeMosaicFilter::Mode mode;
+  int blockSize;
+  
+  //! \return The part of \p original covered by the selection frame,
+  //!         scaled to the size of the selection frame.
+  QImage selection(const QImage & original) const;
+  
+  //! \return One color per LED for \p original.
+  QImage grid(const QImage & original) const;
+};
+
+#endif // __SEMOSAICFILTER_H__
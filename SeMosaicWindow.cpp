@@ -14,11 +14,14 @@
 #include <QDebug>
 #include <QPaintEvent>
 #include <QMouseEvent>
+#include <QtConcurrent>
 
 #include <QPainter>
-#include <QGraphicsItem>
-#include <QGraphicsScene>
-#include <QGraphicsPixmapItem>
+
+//! Delay in milliseconds before the full preview is computed.
+#define SE_PREVIEW_DEBOUNCE 40
+//! Pyramid levels are not halved below this width or height.
+#define SE_PYRAMID_MIN_SIZE 64
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
@@ -61,6 +64,7 @@ void SeMosaicSelectionFrame::setHeight(int height)
 
 SeMosaicImageFrame::SeMosaicImageFrame(QWidget *parent)
   : QLabel(parent)
+  , mPadding(0)
 {
   this->setStyleSheet("background-color: #ffffff; border: 1px solid black;"); 
 }
@@ -102,6 +106,9 @@ void SeMosaicImageFrame::setImage(
     mode = 2;
   }
   
+  this->buildPyramid();
+  mPadding = 0;
+  
   if(keepOffset == false)
   {  
     mOffset.setX(0);
@@ -129,39 +136,61 @@ void SeMosaicImageFrame::setImage(
   this->setImage(QPixmap(filename), keepOffset);
 }
 
+void SeMosaicImageFrame::buildPyramid()
+{
+  mPyramid.clear();
+  
+  QImage level = mOriginalImage.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  mPyramid.append(level);
+  
+  while(level.width() >= 2 * SE_PYRAMID_MIN_SIZE && level.height() >= 2 * SE_PYRAMID_MIN_SIZE)
+  {
+    level = level.scaled( level.width() / 2, level.height() / 2
+                        , Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    mPyramid.append(level);
+  }
+}
+
+const QImage & SeMosaicImageFrame::pyramidLevel(int width, int height) const
+{
+  // smallest level which is still at least as large as the target
+  int n = 0;
+  while(n + 1 < mPyramid.size()
+        && mPyramid[n + 1].width() >= width 
+        && mPyramid[n + 1].height() >= height)
+  {
+    n++;
+  }
+  return mPyramid[n];
+}
+
 void SeMosaicImageFrame::scale(int v)
 {
+  if(mPyramid.isEmpty()) { return; }
+  
   int w = mOriginalImage.width();
   int h = mOriginalImage.height();
      
   float factor = v / 100.f;
   
-  float w0 = w * factor;
-  float h0 = h * factor;
+  int w0 = qMax(1, (int) (w * factor));
+  int h0 = qMax(1, (int) (h * factor));
   
-  QPixmap scaledPixmap = mOriginalImage.copy();
+  const QImage & level = this->pyramidLevel(w0, h0);
   
-  scaledPixmap = scaledPixmap.scaled(w0, h0);
-  
-  QGraphicsScene scene;
-  QGraphicsPixmapItem *p = scene.addPixmap(scaledPixmap);
-  if(p != NULL)
+  if(level.width() == w0 && level.height() == h0)
   {
-    p->setPos(100, 100);
-    p->update();
-    
-    QPixmap outputPix(
-        scaledPixmap.width() + 200
-      , scaledPixmap.height() + 200
-    );    
-    outputPix.fill(Qt::transparent);    
-    QPainter painter(&outputPix);
-    scene.render(&painter, QRectF(100.f, 100.f, scaledPixmap.width(), scaledPixmap.height()));
-    
-    //outputPix.save("C:/temp/scaled.png");
-    
-    mPreparedImage = outputPix.copy();
+    mPreparedImage = QPixmap::fromImage(level);
+  }
+  else
+  {
+    mPreparedImage = QPixmap::fromImage(level.scaled( w0, h0
+                                                    , Qt::IgnoreAspectRatio
+                                                    , Qt::SmoothTransformation));
   }
+  
+  // scaled images are shown with a transparent border 
+  mPadding = SE_SCALE_PADDING;
     
   this->cropAndShow();
   
@@ -172,12 +201,19 @@ void SeMosaicImageFrame::cropAndShow()
 {
   int w = this->width();
   int h = this->height();
-  int x = this->mOffset.x();
-  int y = this->mOffset.y();
+  int x = this->mOffset.x() - mPadding;
+  int y = this->mOffset.y() - mPadding;
+  
+  QRect r = QRect(x, y, w, h).intersected(mPreparedImage.rect());
   
-  QRect r(x, y, w, h);
+  QPixmap cropped(w, h);
+  cropped.fill(Qt::transparent);
   
-  QPixmap cropped = mPreparedImage.copy(r);
+  if(r.isEmpty() == false)
+  {
+    QPainter painter(&cropped);
+    painter.drawPixmap(r.topLeft() - QPoint(x, y), mPreparedImage, r);
+  }
     
   this->setPixmap(cropped);
 }
@@ -216,11 +252,20 @@ void SeMosaicImageFrame::setOffset(const QPoint &offset)
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+int SeMosaicWindow::mPixelSteps = PIXEL_FOR_STEP;
+
+void SeMosaicWindow::setPixelSteps(int steps)
+{
+  mPixelSteps = qMax(1, steps);
+}
+
 SeMosaicWindow::SeMosaicWindow(QWidget *parent) 
   : QDialog(parent)
   , ui(new Ui::SeMosaicWindow)
   , mRenderMosaic(true)
-  , mRenderMosaicMode(MosaicMode::Average)
+  , mRenderMosaicMode(SeMosaicFilter::Average)
+  , mPreviewGeneration(0)
+  , mPreviewJobGeneration(-1)
 {
   ui->setupUi(this);
   
@@ -228,6 +273,7 @@ SeMosaicWindow::SeMosaicWindow(QWidget *parent)
   
   mpImageFrame = ui->lblImgOriginal;
   mpSelectFrame = new SeMosaicSelectionFrame(mpImageFrame);
+  ui->spinBlockSize->setValue(SeMosaicWindow::pixelSteps());
   mpSelectFrame->setWidth(ui->spinSizeWidth->value());
   mpSelectFrame->setHeight(ui->spinSizeHeight->value());
   this->setSelectionGeometry(QRect(0, 0, mpSelectFrame->width(), mpSelectFrame->height()));
@@ -246,10 +292,22 @@ SeMosaicWindow::SeMosaicWindow(QWidget *parent)
                   , this, SLOT(original2preview()));
   QObject::connect( mpImageFrame, SIGNAL(scaleChanged())
                   , this, SLOT(original2preview()));                
+  
+  mPreviewTimer.setSingleShot(true);
+  mPreviewTimer.setInterval(SE_PREVIEW_DEBOUNCE);
+  
+  QObject::connect( &mPreviewTimer, SIGNAL(timeout())
+                  , this, SLOT(startPreviewJob()));
+  QObject::connect( &mPreviewWatcher, SIGNAL(finished())
+                  , this, SLOT(previewJobFinished()));
 }
 
 SeMosaicWindow::~SeMosaicWindow()
 {
+  mPreviewTimer.stop();
+  mPreviewGeneration.fetchAndAddOrdered(1);
+  mPreviewWatcher.waitForFinished();
+  
   delete ui;
   
   if(mpSelectFrame != NULL) { delete mpSelectFrame; mpSelectFrame = NULL; }  
@@ -286,154 +344,151 @@ void SeMosaicWindow::updateSelectionFrameGeometry()
 
 void SeMosaicWindow::original2preview()
 {
-  QPixmap orignalPix = mpImageFrame->pixmap()->copy();
+  if(mpImageFrame->pixmap() == NULL) { return; }
   
   int offsetX = mpSelectFrame->pos().x();
   int offsetY = mpSelectFrame->pos().y();
   int w = mpSelectFrame->width();
   int h = mpSelectFrame->height();
   
-  QPixmap previewPix = orignalPix.copy(offsetX, offsetY, w, h);
+  QPixmap previewPix = mpImageFrame->pixmap()->copy(offsetX, offsetY, w, h);
+  
+  // any job still running works on outdated input
+  mPreviewGeneration.fetchAndAddOrdered(1);
   
   if(mRenderMosaic == true)
   {
-    QImage previewImg = previewPix.toImage();
-    QImage targetImg = previewImg.copy();
-
-    for(int x=0; x < previewPix.width(); x += SeMosaicWindow::pixelSteps())
-    {
-      for(int y=0; y < previewPix.height(); y += SeMosaicWindow::pixelSteps())
-      {
-        QColor pixelColor;
-        
-        switch(this->mosaicMode())
-        {
-          case Average: pixelColor = this->average(x, y, &previewImg); break;
-          case Median:  pixelColor = this->median(x, y, &previewImg);  break;
-          case Minimum: pixelColor = this->minimum(x, y, &previewImg); break;
-          case Maximum: pixelColor = this->maximum(x, y, &previewImg); break;
-          default: /* unknown mode */ ;
-        }
-      
-        for(int ix=x; ix < x + SeMosaicWindow::pixelSteps(); ix++)
-        {
-          for(int iy=y; iy < y + SeMosaicWindow::pixelSteps(); iy++)
-          {          
-            targetImg.setPixel(ix, iy, pixelColor.rgb());
-          }
-        }
-      }
-    }
-
-    QPixmap p = QPixmap::fromImage(targetImg);
-
-    ui->lblImagePreview->setPixmap(p);
+    mPreviewCrop = previewPix.toImage();
+    
+    // rough preview right away, the real filter runs when the input settles
+    int steps = SeMosaicWindow::pixelSteps();
+    QImage roughImg = SeMosaicFilter::expand( SeMosaicFilter::sample(mPreviewCrop, steps)
+                                            , steps, mPreviewCrop.size());
+    
+    ui->lblImagePreview->setPixmap(QPixmap::fromImage(roughImg));
+    
+    mPreviewTimer.start();
   }
   else
   {
+    mPreviewTimer.stop();
+    mPreviewCrop = QImage();
+    
     ui->lblImagePreview->setPixmap(previewPix);
   } 
 }
 
-QColor SeMosaicWindow::average(int x, int y, QImage *pimg)
+void SeMosaicWindow::startPreviewJob()
 {
-  if(pimg == NULL) { return QColor(255,255,255); }
-  if(x < 0 || y < 0) { return QColor(255,255,255); }
+  if(mPreviewCrop.isNull()) { return; }
   
-  QList<int> r_values;
-  QList<int> g_values;
-  QList<int> b_values;
+  // one job at a time, the finished handler restarts the timer
+  if(mPreviewWatcher.isRunning())
+  {
+    mPreviewTimer.start();
+    return;
+  }
   
-  this->pixelArea(x, y, pimg, r_values, g_values, b_values);
+  int generation = mPreviewGeneration.loadAcquire();
+  mPreviewJobGeneration = generation;
   
-  QList<int> rgbAverage;
-  rgbAverage.append(mathAvg<int>(r_values));
-  rgbAverage.append(mathAvg<int>(g_values));
-  rgbAverage.append(mathAvg<int>(b_values));
+  mMosaicFilter.setMode(this->mosaicMode());
+  mMosaicFilter.setBlockSize(SeMosaicWindow::pixelSteps());
+  mMosaicFilter.setPaletteSize(ui->spinPaletteSize->value());
+  mMosaicFilter.setDither((SeDither::Mode) ui->cmbDither->currentIndex());
+  mMosaicFilter.setBitDepth(ui->spinBitDepth->value());
   
-  return QColor(rgbAverage[0], rgbAverage[1], rgbAverage[2]);
+  mPreviewWatcher.setFuture(QtConcurrent::run( &SeMosaicWindow::renderPreview
+                                             , mPreviewCrop
+                                             , mMosaicFilter
+                                             , generation
+                                             , &mPreviewGeneration));
 }
 
-QColor SeMosaicWindow::median(int x, int y, QImage *pimg)
+void SeMosaicWindow::previewJobFinished()
 {
-  if(pimg == NULL) { return QColor(255,255,255); }
-  if(x < 0 || y < 0) { return QColor(255,255,255); }
+  if(mPreviewJobGeneration != mPreviewGeneration.loadAcquire())
+  {
+    // the input changed meanwhile, compute the latest state
+    if(mRenderMosaic == true && !mPreviewCrop.isNull()) { mPreviewTimer.start(); }
+    return;
+  }
   
-  QList<int> r_values;
-  QList<int> g_values;
-  QList<int> b_values;
+  QImage targetImg = mPreviewWatcher.result();
+  if(targetImg.isNull()) { return; }
   
-  this->pixelArea(x, y, pimg, r_values, g_values, b_values);
+  ui->lblImagePreview->setPixmap(QPixmap::fromImage(targetImg));
+  mPreviewCrop = QImage();
+}
+
+void SeMosaicWindow::flushPreview()
+{
+  mPreviewWatcher.waitForFinished();
+  
+  if(mPreviewCrop.isNull()) { return; }
+  
+  mPreviewTimer.stop();
+  
+  // invalidates the result of the job which may have just finished
+  int generation = mPreviewGeneration.fetchAndAddOrdered(1) + 1;
   
-  qSort(r_values.begin(), r_values.end());
-  qSort(g_values.begin(), g_values.end());
-  qSort(b_values.begin(), b_values.end());
+  mMosaicFilter.setMode(this->mosaicMode());
+  mMosaicFilter.setBlockSize(SeMosaicWindow::pixelSteps());
+  mMosaicFilter.setPaletteSize(ui->spinPaletteSize->value());
+  mMosaicFilter.setDither((SeDither::Mode) ui->cmbDither->currentIndex());
+  mMosaicFilter.setBitDepth(ui->spinBitDepth->value());
   
-  QList<int> middleValues;
-  middleValues.append(r_values[SeMosaicWindow::pixelSteps() / 2.f]);
-  middleValues.append(g_values[SeMosaicWindow::pixelSteps() / 2.f]); 
-  middleValues.append(b_values[SeMosaicWindow::pixelSteps() / 2.f]); 
+  QImage targetImg = renderPreview( mPreviewCrop, mMosaicFilter
+                                  , generation, &mPreviewGeneration);
   
-  return QColor(middleValues[0], middleValues[1], middleValues[2]);
+  ui->lblImagePreview->setPixmap(QPixmap::fromImage(targetImg));
+  mPreviewCrop = QImage();
 }
 
-QColor SeMosaicWindow::minimum(int x, int y, QImage *pimg)
+QImage SeMosaicWindow::renderPreview( const QImage & crop
+                                    , SeMosaicFilter filter
+                                    , int generation
+                                    , const QAtomicInt *pcurrentGeneration)
 {
-  if(pimg == NULL) { return QColor(255,255,255); }
-  if(x < 0 || y < 0) { return QColor(255,255,255); }
+  // the filter checks for newer input between its stages and row bands
+  filter.setCancelCheck(pcurrentGeneration, generation);
   
-  QList<int> r_values;
-  QList<int> g_values;
-  QList<int> b_values;
+  QImage grid = filter.grid(crop);
   
-  this->pixelArea(x, y, pimg, r_values, g_values, b_values);
-
-  qSort(r_values.begin(), r_values.end());
-  qSort(g_values.begin(), g_values.end());
-  qSort(b_values.begin(), b_values.end());
+  if(grid.isNull() || filter.isCancelled()) { return QImage(); }
   
-  return QColor(r_values[0], g_values[0], b_values[0]);
+  return SeMosaicFilter::expand(grid, filter.blockSize(), crop.size());
 }
 
-QColor SeMosaicWindow::maximum(int x, int y, QImage *pimg)
+QColor SeMosaicWindow::blockColor(SeMosaicFilter::Mode mode, int x, int y, QImage *pimg)
 {
   if(pimg == NULL) { return QColor(255,255,255); }
   if(x < 0 || y < 0) { return QColor(255,255,255); }
   
-  QList<int> r_values;
-  QList<int> g_values;
-  QList<int> b_values;
-  
-  this->pixelArea(x, y, pimg, r_values, g_values, b_values);
+  mMosaicFilter.setMode(mode);
+  mMosaicFilter.setBlockSize(SeMosaicWindow::pixelSteps());
   
-  qSort(r_values.begin(), r_values.end());
-  qSort(g_values.begin(), g_values.end());
-  qSort(b_values.begin(), b_values.end());
-  
-  return QColor(
-      r_values[ r_values.count() - 1]
-    , g_values[ g_values.count() - 1]
-    , b_values[ b_values.count() - 1]);
+  return QColor(mMosaicFilter.block(*pimg, x, y));
 }
 
-void SeMosaicWindow::pixelArea(
-    int x, int y
-  , QImage *pimg
-  , QList<int> & r_list
-  , QList<int> & g_list
-  , QList<int> & b_list
-) {
-  for(int ix=x; ix < x + SeMosaicWindow::pixelSteps(); ix++)
-  {
-    for(int iy=y; iy < y + SeMosaicWindow::pixelSteps(); iy++)
-    {  
-      QRgb rgb = pimg->pixel(ix, iy);
-      
-      r_list.append(qRed(rgb));
-      g_list.append(qGreen(rgb));
-      b_list.append(qBlue(rgb));
-    }
-  }  
+QColor SeMosaicWindow::average(int x, int y, QImage *pimg)
+{
+  return this->blockColor(SeMosaicFilter::Average, x, y, pimg);
+}
+
+QColor SeMosaicWindow::median(int x, int y, QImage *pimg)
+{
+  return this->blockColor(SeMosaicFilter::Median, x, y, pimg);
+}
+
+QColor SeMosaicWindow::minimum(int x, int y, QImage *pimg)
+{
+  return this->blockColor(SeMosaicFilter::Minimum, x, y, pimg);
+}
+
+QColor SeMosaicWindow::maximum(int x, int y, QImage *pimg)
+{
+  return this->blockColor(SeMosaicFilter::Maximum, x, y, pimg);
 }
 
 void SeMosaicWindow::setOffset(const QPoint &offset)
@@ -466,6 +521,8 @@ void SeMosaicWindow::apply()
 {
   if(mpMainWindow == NULL) { return; }
   
+  this->flushPreview();
+  
   QPixmap p = ui->lblImagePreview->pixmap()->copy();
   
   mpMainWindow->applyPixmap(p);
@@ -538,6 +595,30 @@ void SeMosaicWindow::on_spinSizeHeight_valueChanged(int v)
   this->updateSelectionFrameGeometry();
 }
 
+void SeMosaicWindow::on_spinBlockSize_valueChanged(int steps)
+{
+  SeMosaicWindow::setPixelSteps(steps);
+  this->updateSelectionFrameGeometry();
+}
+
+void SeMosaicWindow::on_spinPaletteSize_valueChanged(int colors)
+{
+  Q_UNUSED(colors);
+  this->original2preview();
+}
+
+void SeMosaicWindow::on_cmbDither_currentIndexChanged(int index)
+{
+  Q_UNUSED(index);
+  this->original2preview();
+}
+
+void SeMosaicWindow::on_spinBitDepth_valueChanged(int bits)
+{
+  Q_UNUSED(bits);
+  this->original2preview();
+}
+
 void SeMosaicWindow::on_chkMosaic_toggled(bool checked)
 {
   this->ui->cmbMosaicMode->setEnabled(checked);
@@ -548,6 +629,8 @@ void SeMosaicWindow::on_chkMosaic_toggled(bool checked)
 void SeMosaicWindow::setMosaicMode(MosaicMode mode)
 {
   this->mRenderMosaicMode = mode;
+  this->ui->cmbMosaicMode->setCurrentIndex((int) mode);
+  this->ui->spinPaletteSize->setEnabled(mode == SeMosaicFilter::Palette);
   this->updateSelectionFrameGeometry();
 }
 
@@ -563,10 +646,11 @@ void SeMosaicWindow::on_cmbMosaicMode_activated(const QString &modename)
 {
   QString m = modename.toLower().trimmed();
   
-  if(m == "average") { this->setMosaicMode(MosaicMode::Average); }
-  else if(m == "median") { this->setMosaicMode(MosaicMode::Median); }
-  else if(m == "minimum") { this->setMosaicMode(MosaicMode::Minimum); }
-  else if(m == "maximum") { this->setMosaicMode(MosaicMode::Maximum); }
+  if(m == "average") { this->setMosaicMode(SeMosaicFilter::Average); }
+  else if(m == "median") { this->setMosaicMode(SeMosaicFilter::Median); }
+  else if(m == "minimum") { this->setMosaicMode(SeMosaicFilter::Minimum); }
+  else if(m == "maximum") { this->setMosaicMode(SeMosaicFilter::Maximum); }
+  else if(m == "palette") { this->setMosaicMode(SeMosaicFilter::Palette); }
   else
   {
     // unknown mosaic mode
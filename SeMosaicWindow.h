@@ -9,20 +9,25 @@
 #ifndef __SEMOSAICWINDOW_H__
 #define __SEMOSAICWINDOW_H__
 
+// SceneEditor
+#include <SeMosaicFilter.h>
+
 // Qt
 #include <QWidget>
 #include <QDialog>
 #include <QPixmap>
 #include <QImage>
+#include <QVector>
 #include <QFrame>
 #include <QLabel>
+#include <QTimer>
+#include <QAtomicInt>
+#include <QFutureWatcher>
 
 namespace Ui {
   class SeMosaicWindow;
 }
 
-#define PIXEL_FOR_STEP 5
-
 // forward-declaration
 class SeMainWindow;
 
@@ -73,6 +78,13 @@ private:
   QPixmap mOriginalImage;
   QPixmap mPreparedImage;
   
+  //! Original image halved per level, built once per setImage().
+  QVector<QImage> mPyramid;
+  int mPadding;
+  
+  void buildPyramid();
+  const QImage & pyramidLevel(int width, int height) const;
+  
 protected:
   void cropAndShow();
   
@@ -138,28 +150,44 @@ private slots:
   void on_spinScale_valueChanged(int arg1);
   void on_spinSelectionOffsetX_valueChanged(int soffx);
   void on_spinSelectionOffsetY_valueChanged(int soffy);
+  void on_spinBlockSize_valueChanged(int steps);
+  void on_spinPaletteSize_valueChanged(int colors);
+  void on_cmbDither_currentIndexChanged(int index);
+  void on_spinBitDepth_valueChanged(int bits);
   
 public slots:
   void updateSelectionFrameGeometry(int x, int y, int width, int height);
   void updateSelectionFrameGeometry();    
   void original2preview();
   
+private slots:
+  void startPreviewJob();
+  void previewJobFinished();
+  
+private:
+  void flushPreview();
+  
+  static QImage renderPreview( const QImage & crop
+                             , SeMosaicFilter filter
+                             , int generation
+                             , const QAtomicInt *pcurrentGeneration);
+  
+public slots:
   QColor average(int x, int y, QImage *pimg);
   QColor median(int x, int y, QImage *pimg);
   QColor minimum(int x, int y, QImage *pimg);
   QColor maximum(int x, int y, QImage *pimg);
   
-  void pixelArea(int x, int y, QImage *pimg, QList<int> & r, QList<int> & g, QList<int> & b);
-    
-public:
-  template<class T> T mathAvg(const QList<T> & list) {
-    T _v = 0.f;
-    for(auto vv : list) { _v += vv; }
-    return (_v / (T) list.count());
-  }
+private:
+  QColor blockColor(SeMosaicFilter::Mode mode, int x, int y, QImage *pimg);
   
 public:
-  static inline int pixelSteps() { return PIXEL_FOR_STEP; }  
+  //! Number of source pixels per LED in each direction.
+  static inline int pixelSteps() { return mPixelSteps; }  
+  static void setPixelSteps(int steps);
+  
+private:
+  static int mPixelSteps;
   
 private:
   Ui::SeMosaicWindow *ui;
@@ -168,7 +196,7 @@ private:
   SeMosaicSelectionFrame *mpSelectFrame;
   
 public:
-  enum MosaicMode { Average, Median, Minimum, Maximum };
+  typedef SeMosaicFilter::Mode MosaicMode;
   
   void setMosaicMode(MosaicMode mode);
   MosaicMode mosaicMode() const { return mRenderMosaicMode; }
@@ -181,6 +209,16 @@ private:
   
   QRect mSelectionFrameGeometry;
   
+  SeMosaicFilter mMosaicFilter;
+  
+  // background preview, input is debounced by mPreviewTimer and each 
+  // new input bumps mPreviewGeneration, so running jobs can give up
+  QTimer mPreviewTimer;
+  QImage mPreviewCrop;
+  QAtomicInt mPreviewGeneration;
+  int mPreviewJobGeneration;
+  QFutureWatcher<QImage> mPreviewWatcher;
+  
   QPixmap mPixmap;
 };
 
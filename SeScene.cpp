@@ -19,6 +19,7 @@
 
 SeScene::SeScene(QObject *parent) 
   : QGraphicsScene(parent)
+  , mpPlaybackLayer(NULL)
 { }
 
 SeScene::~SeScene()
@@ -36,35 +37,76 @@ SeSceneLayer *SeScene::addLayer(int rows, int columns)
 
 SeSceneLayer* SeScene::layer(const QString & identifier)
 {
-  for(QGraphicsItem *p : this->items())
+  SeSceneLayer *p = mLayerIndex.value(identifier, NULL);
+  if(p != NULL && p->identifier() == identifier) { return p; }
+  
+  // identifiers are assigned after a layer has been added
+  this->rebuildLayerIndex();
+  
+  return mLayerIndex.value(identifier, NULL);
+}
+
+void SeScene::registerLayer(SeSceneLayer *ptrLayer)
+{
+  if(ptrLayer == NULL || mLayerList.contains(ptrLayer)) { return; }
+  
+  mLayerList.append(ptrLayer);
+  mLayerIndex.insert(ptrLayer->identifier(), ptrLayer);
+}
+
+void SeScene::unregisterLayer(SeSceneLayer *ptrLayer)
+{
+  if(mLayerList.removeOne(ptrLayer) == false) { return; }
+  
+  if(mLayerIndex.value(ptrLayer->identifier(), NULL) == ptrLayer)
   {
-    SE_CONT4NULL(p);
-      
-    SeSceneLayer *pl = dynamic_cast<SeSceneLayer*>(p);    
-    SE_CONT4NULL(pl);    
-    
-    if(pl->identifier() == identifier)
-    {
-      return pl;
-    }
+    mLayerIndex.remove(ptrLayer->identifier());
   }
   
-  return NULL;
+  if(mpPlaybackLayer == ptrLayer) { mpPlaybackLayer = NULL; }
+}
+
+void SeScene::rebuildLayerIndex()
+{
+  mLayerIndex.clear();
+  
+  for(SeSceneLayer *p : mLayerList)
+  {
+    mLayerIndex.insert(p->identifier(), p);
+  }
 }
 
 int SeScene::sceneLayers(QList<SeSceneLayer*> & layers, SeSceneItem *parent)
 {
-  return this->sceneItems<SeSceneLayer>(layers, parent);
+  // layers are always top-level items
+  if(parent != NULL) { return layers.count(); }
+  
+  layers.append(mLayerList);
+  
+  return layers.count();
 }
 
 int SeScene::sceneLeds(QList<SeSceneLed*> &leds, SeSceneItem *parent)
 {
-  return this->sceneItems<SeSceneLed>(leds, parent);
+  if(parent != NULL)
+  {
+    SeSceneLayer *pl = dynamic_cast<SeSceneLayer*>(parent);
+    if(pl != NULL) { pl->leds(leds); }
+    
+    return leds.count();
+  }
+  
+  for(SeSceneLayer *pl : mLayerList)
+  {
+    pl->leds(leds);
+  }
+  
+  return leds.count();
 }
 
 int SeScene::selectedLeds(QList<SeSceneLed*> &leds)
 {
-  return this->sceneItems<SeSceneLed>(leds);
+  return this->sceneLeds(leds);
 
   for(QGraphicsItem *p : this->selectedItems())
   {
@@ -76,11 +118,56 @@ int SeScene::selectedLeds(QList<SeSceneLed*> &leds)
   return leds.count();
 }
 
+SeSceneItem *SeScene::sceneItemAt(const QPointF & scenePos)
+{
+  for(int i=mLayerList.count() - 1; i >= 0; --i)
+  {
+    SeSceneLayer *pl = mLayerList.at(i);
+    if(pl->isVisible() == false) { continue; }
+    
+    QPointF local = pl->mapFromScene(scenePos);
+    if(pl->boundingRect().contains(local) == false) { continue; }
+    
+    SeSceneItem *pled = pl->sceneItemAt(local);
+    if(pled != NULL) { return pled; }
+    
+    return pl;
+  }
+  
+  return NULL;
+}
+
 void SeScene::exportLayer(SeSceneLayer *ptrLayer, const QString &filepath)
 {
-  this->hideAllLayer();
+  QImage image = this->renderLayer(ptrLayer);
+  
+  if(filepath.isEmpty())
+  {  
+    #ifdef WIN32
+      image.save(QString("C:/temp/exports/%1.png").arg(ptrLayer->identifier()));
+    #else
+      image.save(QString("~/exports/%1.png").arg(ptrLayer->identifier()));
+    #endif
+  }
+  else
+  {
+    image.save(filepath);
+  }
+}
+
+QImage SeScene::renderLayer(SeSceneLayer *ptrLayer)
+{
+  bool isInScene = ptrLayer->scene() == this;
   
-  ptrLayer->show();
+  // drawForeground() must not paint a playback frame into the image
+  SeSceneLayer *playbackLayer = mpPlaybackLayer;
+  
+  if(isInScene)
+  {
+    mpPlaybackLayer = NULL;
+    this->hideAllLayer();
+    ptrLayer->show();
+  }
   
   SeSceneItem *firstItem = ptrLayer->sceneItem(0, 0);
   
@@ -94,29 +181,56 @@ void SeScene::exportLayer(SeSceneLayer *ptrLayer, const QString &filepath)
   painter.setBrush(QColor(255, 255, 255));
   painter.setPen(QColor(255, 255, 255));
   painter.drawRect(0, 0, w, h);
-  this->render(&painter, QRectF(0, 0, w, h), QRectF(0, 0, w, h));
-  painter.end();
-  
-  if(filepath.isEmpty())
-  {  
-    #ifdef WIN32
-      image.save(QString("C:/temp/exports/%1.png").arg(ptrLayer->identifier()));
-    #else
-      image.save(QString("~/exports/%1.png").arg(ptrLayer->identifier()));
-    #endif
+  if(isInScene)
+  {
+    this->render(&painter, QRectF(0, 0, w, h), QRectF(0, 0, w, h));
   }
   else
   {
-    image.save(filepath);
+    // e.g. playback frames, these are never added to the scene
+    ptrLayer->renderGrid(&painter);
+  }
+  painter.end();
+  
+  mpPlaybackLayer = playbackLayer;
+  
+  return image;
+}
+
+void SeScene::setPlaybackLayer(SeSceneLayer *ptrLayer)
+{
+  if(mpPlaybackLayer == ptrLayer) { return; }
+  
+  if(mpPlaybackLayer != NULL) { this->update(mpPlaybackLayer->boundingRect()); }
+  
+  mpPlaybackLayer = ptrLayer;
+  
+  if(mpPlaybackLayer != NULL) { this->update(mpPlaybackLayer->boundingRect()); }
+}
+
+void SeScene::setLevelOfDetail(qreal zoom)
+{
+  for(SeSceneLayer *ptr : mLayerList)
+  {
+    SE_CONT4NULL(ptr);
+    SeSceneItem *pfirst = ptr->sceneItem(0, 0);
+    SE_CONT4NULL(pfirst);
+    ptr->setLowDetail(SeSceneLayer::isLowDetail(pfirst->width(), zoom));
   }
 }
 
+void SeScene::drawForeground(QPainter *painter, const QRectF & rect)
+{
+  if(mpPlaybackLayer == NULL) { return; }
+  
+  mpPlaybackLayer->renderGrid(painter, rect);
+}
+
 void SeScene::hideAllLayer()
 {
-  QList<SeSceneLayer*> layers;
-  /*int n =*/ this->sceneLayers(layers);
+  this->setPlaybackLayer(NULL);
   
-  for(SeSceneLayer *ptr : layers)
+  for(SeSceneLayer *ptr : mLayerList)
   {
     SE_CONT4NULL(ptr);
     ptr->hide();
@@ -128,12 +242,10 @@ bool SeScene::showLayer(const QString & identifier)
   SeSceneLayer *p = this->layer(identifier);
   if(p == NULL) { return false; }
   
-  QList<SeSceneLayer*> layers;
+  // the edited layer must not be covered by the last playback frame
+  this->setPlaybackLayer(NULL);
   
-  int n = this->sceneLayers(layers);  
-  if(n == 0) { return false; }
-  
-  for(auto pitem : layers)
+  for(auto pitem : mLayerList)
   {
     pitem->hide();
   }
@@ -145,15 +257,10 @@ bool SeScene::showLayer(const QString & identifier)
 
 void SeScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 {
-  QGraphicsItem *p = this->itemAt(event->scenePos(), QTransform());
-
-  if(p != NULL)
+  SeSceneItem *pit = this->sceneItemAt(event->scenePos());
+  if(pit != NULL)
   {
-    SeSceneItem *pit = dynamic_cast<SeSceneItem*>(p);
-    if(pit != NULL)
-    {
-      emit this->item(pit);
-    }
+    emit this->item(pit);
   }
 
   QGraphicsScene::mouseReleaseEvent(event);
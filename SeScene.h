@@ -11,6 +11,9 @@
 
 // Qt
 #include <QObject>
+#include <QHash>
+#include <QList>
+#include <QImage>
 #include <QStatusBar>
 #include <QGraphicsScene>
 #include <QSharedPointer>
@@ -38,8 +41,10 @@ public:
   
   SeSceneLayer* addLayer(int rows, int columns);
   
+  //! \return The layer with \p identifier, a hash lookup.
   SeSceneLayer* layer(const QString & identifier);      
   
+  //! Layers and LEDs are taken from the registry, not from items().
   int sceneLayers(QList<SeSceneLayer*> & layers, SeSceneItem *parent=0);
   int sceneLeds(QList<SeSceneLed*> & leds, SeSceneItem *parent=0);    
   template<class T> int sceneItems(QList<T*> & itemlist, SeSceneItem *parent=NULL) {
@@ -53,6 +58,14 @@ public:
   
   bool showLayer(const QString & identifier);
   
+  //! \return The topmost visible LED or layer at \p scenePos, computed 
+  //!         from the grid geometry of the layers.
+  SeSceneItem *sceneItemAt(const QPointF & scenePos);
+  
+  //! Called by SeSceneLayer when it enters or leaves this scene.
+  void registerLayer(SeSceneLayer *ptrLayer);
+  void unregisterLayer(SeSceneLayer *ptrLayer);
+  
   int selectedLeds(QList<SeSceneLed*> & leds);
      
   //! \brief ...
@@ -61,10 +74,34 @@ public:
   //!                 and "~/exports/ on Unix-based systems.
   void exportLayer(SeSceneLayer *ptrLayer, const QString & filepath="");
   
+  //! \return The image exportLayer() writes for \p ptrLayer.
+  QImage renderLayer(SeSceneLayer *ptrLayer);
+  
   void hideAllLayer();
+  
+  //! Shows \p ptrLayer on top of the scene without adding it, i.e. 
+  //! it is not part of the index, items() or any hit test. NULL 
+  //! removes the playback layer.
+  void setPlaybackLayer(SeSceneLayer *ptrLayer);
+  SeSceneLayer *playbackLayer() const { return mpPlaybackLayer; }
+  
+  //! Called by the view before it paints at \p zoom, layers which are
+  //! too small hide their LEDs instead of traversing them.
+  void setLevelOfDetail(qreal zoom);
      
 protected:
   void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
+  void drawForeground(QPainter *painter, const QRectF & rect);
+  
+private:
+  SeSceneLayer *mpPlaybackLayer;
+  
+  // registered layers in order of insertion, i.e. bottom to top
+  QList<SeSceneLayer*> mLayerList;
+  // identifier to layer, rebuilt when an identifier has changed
+  QHash<QString, SeSceneLayer*> mLayerIndex;
+  
+  void rebuildLayerIndex();
            
 signals:
   void item(SeSceneItem*);
@@ -10,7 +10,6 @@
 #include <SeSceneLed.h>
 
 // Qt
-#include <QUuid>
 #include <QDebug>
 #include <QObject>
 #include <QBuffer>
@@ -18,87 +17,153 @@
 
 // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+void SeLedStore::resize(int rows, int columns, const SeLedCell & init)
+{
+  QSharedDataPointer<Row> row(new Row());
+  row->cells.fill(init, columns);
+  
+  mRows.fill(row, rows);
+}
+
+SeLedCell & SeLedStore::editCell(int row, int column)
+{
+  // detaches the list of rows and afterwards the row itself
+  return mRows[row]->cells[column];
+}
+
+// ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
 SeSceneItemProperties::SeSceneItemProperties() 
   : mrow(-1)
   , mcolumn(-1)
-  , mtransitionMode(Hard)
-  , mSize(50, 50)
-  , mShapeMode(ShapeRect)
-  , mOffset(0, 0)
-  , mScale(100)
-  , mEnabled(true)
-  , mIndex(-1)
+  , mpstore(NULL)
   , powner(NULL)
 {  
-  mbrushcolor = QColor(255, 255, 255);
-  mpencolor = QColor(0, 0, 0);
+  mcell.brush = qRgb(255, 255, 255);
+  mcell.pen = qRgb(0, 0, 0);
+  mcell.width = 50;
+  mcell.height = 50;
+  mcell.shapeMode = ShapeRect;
+  mcell.transitionMode = Hard;
 }
 
 SeSceneItemProperties::SeSceneItemProperties(const SeSceneItemProperties &obj)
   : midentifier(obj.midentifier)
+  , mlayer(obj.mlayer)
   , mrow(obj.mrow)
   , mcolumn(obj.mcolumn)
-  , mbrushcolor(obj.mbrushcolor)
-  , mpencolor(obj.mpencolor)
-  , mtransitionMode(obj.mtransitionMode)
-  , mOriginalFilePath(obj.mOriginalFilePath)
-  , mOriginalPixmap(obj.mOriginalPixmap)
-  , mSize(obj.mSize)
-  , mOffset(obj.mOffset)
-  , mSelectionGeometry(obj.mSelectionGeometry)
-  , mShapeMode(obj.mShapeMode)  
-  , mEnabled(obj.mEnabled)
-  , mIndex(obj.mIndex)
-  , powner(obj.powner) { }
+  , mcell(obj.cell())
+  , mpstore(NULL)
+  , powner(NULL) { }
 
 SeSceneItemProperties & SeSceneItemProperties::operator=(const SeSceneItemProperties & obj)
 {
+  if(this == &obj) { return *this; }
+  
+  // the owner is not a property, i.e. the copied values still belong 
+  // to this item and must not repaint or serialize the source item
   midentifier = obj.midentifier;
-  mrow = obj.mrow;
-  mcolumn = obj.mcolumn;
-  mbrushcolor = obj.mbrushcolor;
-  mpencolor = obj.mpencolor;
-  mtransitionMode = obj.mtransitionMode;
-  mOriginalFilePath = obj.mOriginalFilePath;
-  mOriginalPixmap = obj.mOriginalPixmap;
-  mSize = obj.mSize;
-  mOffset = obj.mOffset;
-  mSelectionGeometry = obj.mSelectionGeometry;
-  mShapeMode = obj.mShapeMode;
-  mEnabled = obj.mEnabled;
-  mIndex = obj.mIndex;
-  powner = obj.powner;
+  mlayer = obj.mlayer;
+  
+  if(mpstore == NULL)
+  {
+    mrow = obj.mrow;
+    mcolumn = obj.mcolumn;
+  }
+  
+  // an unchanged cell must not detach a shared row
+  SeLedCell c = obj.cell();
+  if(this->cell() != c) { this->editCell() = c; }
+  
   return *this;
 }
 
+void SeSceneItemProperties::setStore(SeLedStore *store, int row, int column)
+{
+  mrow = row;
+  mcolumn = column;
+  mpstore = store;
+}
+
+const SeSceneLayerData *SeSceneItemProperties::layerData() const
+{
+  static const SeSceneLayerData defaults;
+  
+  if(mlayer.constData() == NULL) { return &defaults; }
+  
+  return mlayer.constData();
+}
+
+SeSceneLayerData *SeSceneItemProperties::layerData()
+{
+  if(mlayer.constData() == NULL) { mlayer = new SeSceneLayerData(); }
+  
+  return mlayer.data();
+}
+
 void SeSceneItemProperties::setIdentifier(const QString &identifier) { this->midentifier = identifier; }
-void SeSceneItemProperties::setRow(int row)         { this->mrow = row;  }
-void SeSceneItemProperties::setColumn(int column)   { this->mcolumn = column; }
-void SeSceneItemProperties::setBrushColor(QColor c) { this->mbrushcolor = c; }
-void SeSceneItemProperties::setPenColor(QColor c)   { this->mpencolor = c; }
-void SeSceneItemProperties::setTransitionMode(TransitionMode mode) { this->mtransitionMode = mode; }
-void SeSceneItemProperties::setOriginalFilePath(const QString &filePath) { mOriginalFilePath = filePath; }
-void SeSceneItemProperties::setOriginalPixmap(const QPixmap &pix) { mOriginalPixmap = pix; }
-void SeSceneItemProperties::setSize(const QSize &size) { mSize = size; }
-void SeSceneItemProperties::setSize(int w, int h) { mSize = QSize(w, h); }
-void SeSceneItemProperties::setShapeMode(ShapeMode mode) { mShapeMode = mode; }
-void SeSceneItemProperties::setOffset(const QPoint &offset) { mOffset = offset; }
-void SeSceneItemProperties::setSelectionGeometry(const QRect & rect) { mSelectionGeometry = rect; }
-void SeSceneItemProperties::setScale(int scale) { if(scale < 0) { mScale = 100; } else { mScale = scale; } }
-void SeSceneItemProperties::setEnabled(bool state) { mEnabled = state; }
-void SeSceneItemProperties::setIndex(int index) { mIndex = index; }
+
+QString SeSceneItemProperties::identifier() const
+{
+  if(midentifier.isEmpty() == false || powner == NULL) { return midentifier; }
+  
+  SeSceneLayer *layer = dynamic_cast<SeSceneLayer*>(powner->parentItem());
+  if(layer == NULL) { return midentifier; }
+  
+  return QString("%1-%2-%3").arg(layer->identifier()).arg(mrow).arg(mcolumn);
+}
+
+void SeSceneItemProperties::setRow(int row)         { if(mpstore == NULL) { this->mrow = row; } }
+void SeSceneItemProperties::setColumn(int column)   { if(mpstore == NULL) { this->mcolumn = column; } }
+void SeSceneItemProperties::setBrushColor(QColor c) { if(cell().brush != c.rgba()) { editCell().brush = c.rgba(); this->changed(); } }
+void SeSceneItemProperties::setPenColor(QColor c)   { if(cell().pen != c.rgba()) { editCell().pen = c.rgba(); this->changed(); } }
+void SeSceneItemProperties::setTransitionMode(TransitionMode mode) { if(cell().transitionMode != mode) { editCell().transitionMode = mode; } }
+void SeSceneItemProperties::setOriginalFilePath(const QString &filePath) { layerData()->mOriginalFilePath = filePath; }
+void SeSceneItemProperties::setOriginalPixmap(const QPixmap &pix) { layerData()->mOriginalPixmap = pix; }
+void SeSceneItemProperties::setSize(const QSize &size) { this->setSize(size.width(), size.height()); }
+void SeSceneItemProperties::setSize(int w, int h) { if(size() != QSize(w, h)) { SeLedCell & c = editCell(); c.width = qBound(0, w, 0xffff); c.height = qBound(0, h, 0xffff); } }
+void SeSceneItemProperties::setShapeMode(ShapeMode mode) { if(cell().shapeMode != mode) { editCell().shapeMode = mode; this->changed(); } }
+void SeSceneItemProperties::setOffset(const QPoint &offset) { layerData()->mOffset = offset; }
+void SeSceneItemProperties::setSelectionGeometry(const QRect & rect) { layerData()->mSelectionGeometry = rect; }
+void SeSceneItemProperties::setScale(int scale) { if(scale < 0) { layerData()->mScale = 100; } else { layerData()->mScale = scale; } }
+void SeSceneItemProperties::setMosaicMode(int mode) { layerData()->mMosaicMode = mode; }
+void SeSceneItemProperties::setEnabled(bool state) { layerData()->mEnabled = state; }
+void SeSceneItemProperties::setIndex(int index) { layerData()->mIndex = index; }
+
+void SeSceneItemProperties::changed()
+{
+  // only the owner is repainted, a partially updating view 
+  // does not have to touch any other LED
+  if(powner == NULL) { return; }
+  
+  powner->update();
+  
+  // a zoomed out layer shows the LED within its own, possibly cached, image
+  SeSceneLayer *layer = dynamic_cast<SeSceneLayer*>(powner->parentItem());
+  if(layer != NULL) 
+  {
+    layer->invalidateLod();
+    layer->update(powner->mapRectToParent(powner->boundingRect()));
+  }
+}
 
 void SeSceneItemProperties::restore(const QJsonObject & obj)
 {
   bool isLayer = dynamic_cast<SeSceneLayer*>(powner) != NULL;
   bool isLed   = dynamic_cast<SeSceneLed*>(powner) != NULL;
 
-  this->midentifier = obj["Identifier"].toString();
+  // an LED is identified by its layer, row and column, identifiers 
+  // stored by older versions are not kept
+  if(isLed == false)
+  {
+    this->midentifier = obj["Identifier"].toString();
+  }
 
   if(isLed == true)
   {
-    this->mrow = obj["Row"].toInt();
-    this->mcolumn = obj["Column"].toInt();
+    // an LED of a layer keeps the cell assigned by setStore()
+    this->setRow(obj["Row"].toInt());
+    this->setColumn(obj["Column"].toInt());
   
     int rgb0;
     int rgb1;
@@ -109,37 +174,36 @@ void SeSceneItemProperties::restore(const QJsonObject & obj)
     this->setBrushColor(QColor(qRed(rgb0), qGreen(rgb0), qBlue(rgb0)));
     this->setPenColor(QColor(qRed(rgb1), qGreen(rgb1), qBlue(rgb1)));
 
-    this->mtransitionMode = (TransitionMode) obj["TransitionMode"].toInt();
-
-    int w = obj["Width"].toInt();
-    int h = obj["Height"].toInt();
+    this->setTransitionMode((TransitionMode) obj["TransitionMode"].toInt());
 
-    mSize.setWidth(w);
-    mSize.setHeight(h);
+    this->setSize(obj["Width"].toInt(), obj["Height"].toInt());
   }
 
   if(isLayer)
   {  
-    this->mOriginalFilePath = obj["OriginalFilePath"].toString();
+    SeSceneLayerData *d = this->layerData();
+    
+    d->mOriginalFilePath = obj["OriginalFilePath"].toString();
     
     QByteArray ba0; ba0.append(obj["OriginalPixmap"].toString());
     QByteArray img0 = QByteArray::fromBase64(ba0);
     QImage img00 = QImage::fromData(img0, "PNG");
-    mOriginalPixmap = QPixmap::fromImage(img00);
+    d->mOriginalPixmap = QPixmap::fromImage(img00);
     
-    mShapeMode = (ShapeMode) obj["ShapeMode"].toInt();  
+    editCell().shapeMode = (quint8) obj["ShapeMode"].toInt();  
     
-    mOffset.setX(obj["OffsetX"].toInt());
-    mOffset.setY(obj["OffsetY"].toInt());
+    d->mOffset.setX(obj["OffsetX"].toInt());
+    d->mOffset.setY(obj["OffsetY"].toInt());
     
-    mSelectionGeometry.setX(obj["SelectionGeometryX"].toInt());
-    mSelectionGeometry.setY(obj["SelectionGeometryY"].toInt());
-    mSelectionGeometry.setWidth(obj["SelectionGeometryW"].toInt());
-    mSelectionGeometry.setHeight(obj["SelectionGeometryH"].toInt());
+    d->mSelectionGeometry.setX(obj["SelectionGeometryX"].toInt());
+    d->mSelectionGeometry.setY(obj["SelectionGeometryY"].toInt());
+    d->mSelectionGeometry.setWidth(obj["SelectionGeometryW"].toInt());
+    d->mSelectionGeometry.setHeight(obj["SelectionGeometryH"].toInt());
     
-    mScale = obj["Scale"].toInt();    
-    mEnabled = obj["Enabled"].toBool();
-    mIndex = obj["Index"].toInt();
+    d->mScale = obj["Scale"].toInt();    
+    d->mMosaicMode = obj["MosaicMode"].toInt();
+    d->mEnabled = obj["Enabled"].toBool();
+    d->mIndex = obj["Index"].toInt();
   }
       
   powner->update();
@@ -152,41 +216,44 @@ QJsonObject SeSceneItemProperties::toJson()
 
   QJsonObject o;
 
-  o["Identifier"] = this->midentifier;
+  o["Identifier"] = this->identifier();
 
   if(isLed == true)
   {
     o["Row"] = this->mrow;
     o["Column"] = this->mcolumn;
-    o["BrushColor"] = (int) this->mbrushcolor.rgb();
-    o["PenColor"] = (int) this->mpencolor.rgb();
-    o["TransitionMode"] = this->mtransitionMode;
+    o["BrushColor"] = (int) (this->brushRgb() | 0xff000000);
+    o["PenColor"] = (int) (this->penRgb() | 0xff000000);
+    o["TransitionMode"] = (int) this->transitionMode();
 
-    o["Width"] = this->mSize.width();
-    o["Height"] = this->mSize.height();
+    o["Width"] = this->width();
+    o["Height"] = this->height();
   }
 
   if(isLayer == true)
   {  
-    o["OriginalFilePath"] = this->mOriginalFilePath;
+    const SeSceneLayerData *d = this->layerData();
+    
+    o["OriginalFilePath"] = d->mOriginalFilePath;
     
     QByteArray byteArray0;
     QBuffer buffer0(&byteArray0);
-    mOriginalPixmap.save(&buffer0, "PNG");
+    d->mOriginalPixmap.save(&buffer0, "PNG");
     o["OriginalPixmap"] = byteArray0.toBase64().data();
       
     o["ShapeMode"] = (int) this->shapeMode();
     o["OffsetX"] = (int) this->offset().x();
     o["OffsetY"] = (int) this->offset().y();
       
-    o["SelectionGeometryX"] = (int) this->mSelectionGeometry.x();
-    o["SelectionGeometryY"] = (int) this->mSelectionGeometry.y(); 
-    o["SelectionGeometryW"] = (int) this->mSelectionGeometry.width();
-    o["SelectionGeometryH"] = (int) this->mSelectionGeometry.height();
+    o["SelectionGeometryX"] = (int) d->mSelectionGeometry.x();
+    o["SelectionGeometryY"] = (int) d->mSelectionGeometry.y(); 
+    o["SelectionGeometryW"] = (int) d->mSelectionGeometry.width();
+    o["SelectionGeometryH"] = (int) d->mSelectionGeometry.height();
     
-    o["Scale"] = (int) this->mScale;
-    o["Enabled"] = (bool) this->mEnabled;
-    o["Index"] = (int) this->mIndex;
+    o["Scale"] = (int) d->mScale;
+    o["MosaicMode"] = (int) d->mMosaicMode;
+    o["Enabled"] = (bool) d->mEnabled;
+    o["Index"] = (int) d->mIndex;
   }
   
   return o;
@@ -194,11 +261,13 @@ QJsonObject SeSceneItemProperties::toJson()
 
 // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+QGraphicsItem::CacheMode SeSceneItem::sDefaultCacheMode = QGraphicsItem::NoCache;
+
 SeSceneItem::SeSceneItem(QGraphicsItem *parent) 
   : QGraphicsItem(parent)
 {
-  this->properties().setIdentifier(QUuid::createUuid().toString());
   this->properties().setOwner(this);
+  this->setCacheMode(sDefaultCacheMode);
 }
 
 SeSceneItem::~SeSceneItem()
@@ -10,9 +10,15 @@
 #define __SESCENEITEM_H__
 
 // Qt
+#include <QRgb>
 #include <QSize>
+#include <QRect>
+#include <QPoint>
 #include <QColor>
 #include <QObject>
+#include <QVector>
+#include <QPixmap>
+#include <QSharedData>
 #include <QJsonObject>
 #include <QGraphicsItem>
 
@@ -21,7 +27,92 @@ class SeSceneLed;
 class SeSceneItem;
 
 /**
- * @brief The SeSceneLedProperties class
+ * @brief The SeSceneLayerData class
+ *
+ * Properties which are only meaningful for a layer, i.e. the source
+ * image of the mosaic and how it was cropped. LEDs do not allocate
+ * this block at all, copies of a layer share it until one is changed.
+ */
+class SeSceneLayerData
+  : public QSharedData
+{
+public:
+  SeSceneLayerData()
+    : mOffset(0, 0)
+    , mScale(100)
+    , mMosaicMode(0)
+    , mEnabled(true)
+    , mIndex(-1) { }
+
+  QString mOriginalFilePath;
+  QPixmap mOriginalPixmap;
+  QPoint mOffset;
+  QRect mSelectionGeometry;
+  int mScale;
+  int mMosaicMode;
+  bool mEnabled;
+  int mIndex;
+};
+
+/**
+ * @brief The SeLedCell struct
+ *
+ * Packed state of a single LED.
+ */
+struct SeLedCell
+{
+  QRgb brush;
+  QRgb pen;
+  quint16 width;
+  quint16 height;
+  quint8 shapeMode;
+  quint8 transitionMode;
+
+  bool operator==(const SeLedCell & obj) const {
+    return brush == obj.brush && pen == obj.pen
+        && width == obj.width && height == obj.height
+        && shapeMode == obj.shapeMode && transitionMode == obj.transitionMode;
+  }
+  bool operator!=(const SeLedCell & obj) const { return !(*this == obj); }
+};
+
+/**
+ * @brief The SeLedStore class
+ *
+ * The LED cells of a layer, row by row. Copies share all rows, the 
+ * first change of a cell copies its row only, i.e. a duplicated 
+ * layer costs memory for the rows which are edited afterwards.
+ */
+class SeLedStore
+{
+public:
+  //! All rows share one row of \p columns times \p init.
+  void resize(int rows, int columns, const SeLedCell & init);
+
+  int rows() const { return mRows.count(); }
+  int columns() const { return mRows.isEmpty() ? 0 : mRows.first()->cells.count(); }
+
+  const SeLedCell & cell(int row, int column) const { return mRows.at(row)->cells.at(column); }
+  //! \return The cell, its row is detached for writing.
+  SeLedCell & editCell(int row, int column);
+
+private:
+  class Row 
+    : public QSharedData
+  {
+  public:
+    QVector<SeLedCell> cells;
+  };
+
+  QVector< QSharedDataPointer<Row> > mRows;
+};
+
+/**
+ * @brief The SeSceneItemProperties class
+ *
+ * The per LED part is packed into a SeLedCell, LEDs of a layer keep
+ * it in the SeLedStore of the layer. Layer-level properties live in 
+ * SeSceneLayerData which is created by the first layer-level setter.
  */
 class SeSceneItemProperties
 {
@@ -30,11 +121,18 @@ public:
   enum TransitionMode { Hard=0, Fade=1 };
 
   SeSceneItemProperties();
+  //! The copy keeps its own cell and has no owner, i.e. it is a 
+  //! snapshot of \p obj which does not repaint any item.
   SeSceneItemProperties(const SeSceneItemProperties & obj);
+  //! Copies the values, the owner and the cell in the store are kept.
   SeSceneItemProperties & operator=(const SeSceneItemProperties & obj);
 
   void setOwner(SeSceneItem *p) { this->powner = p; }
+  //! Keeps the LED state in the cell \p row, \p column of \p store.
+  void setStore(SeLedStore *store, int row, int column);
   void setIdentifier(const QString & identifier);
+  //! Ignored for LEDs of a layer, their position is the address of
+  //! their cell in the store, see setStore().
   void setRow(int row);
   void setColumn(int column);
   void setBrushColor(QColor c);
@@ -48,26 +146,32 @@ public:
   void setOffset(const QPoint & offset);
   void setSelectionGeometry(const QRect & rect);
   void setScale(int scale);
+  void setMosaicMode(int mode);
   void setEnabled(bool state);
   void setIndex(int index);
 
-  QString identifier() const { return midentifier; }
+  //! LEDs without an explicit identifier are identified by their
+  //! position, the string is composed on request only.
+  QString identifier() const;
   int row() const { return mrow; }
   int column() const { return mcolumn; }
-  QColor brushColor() const { return mbrushcolor; }
-  QColor penColor() const { return mpencolor; }
-  TransitionMode transitionMode() const { return mtransitionMode; }
-  QString originalFilePath() const { return mOriginalFilePath; }
-  QPixmap originalPixmap() const { return mOriginalPixmap; }
-  QSize size() const { return mSize; }
-  int width() const { return mSize.width(); }
-  int height() const { return mSize.height(); }
-  ShapeMode shapeMode() const { return mShapeMode; }
-  QPoint offset() const { return mOffset; }
-  QRect selectionGeometry() const { return mSelectionGeometry; }
-  int scale() const { return mScale; }
-  bool enabled() const { return mEnabled; }
-  int index() const { return mIndex; }
+  QColor brushColor() const { return QColor::fromRgba(cell().brush); }
+  QColor penColor() const { return QColor::fromRgba(cell().pen); }
+  QRgb brushRgb() const { return cell().brush; }
+  QRgb penRgb() const { return cell().pen; }
+  TransitionMode transitionMode() const { return (TransitionMode) cell().transitionMode; }
+  QString originalFilePath() const { return layerData()->mOriginalFilePath; }
+  QPixmap originalPixmap() const { return layerData()->mOriginalPixmap; }
+  QSize size() const { return QSize(cell().width, cell().height); }
+  int width() const { return cell().width; }
+  int height() const { return cell().height; }
+  ShapeMode shapeMode() const { return (ShapeMode) cell().shapeMode; }
+  QPoint offset() const { return layerData()->mOffset; }
+  QRect selectionGeometry() const { return layerData()->mSelectionGeometry; }
+  int scale() const { return layerData()->mScale; }
+  int mosaicMode() const { return layerData()->mMosaicMode; }
+  bool enabled() const { return layerData()->mEnabled; }
+  int index() const { return layerData()->mIndex; }
 
   friend class SeSceneItem;
   friend class SeSceneLed;
@@ -77,22 +181,24 @@ public:
   QJsonObject toJson();
 
 private:
+  //! Schedules a repaint of the owner.
+  void changed();
+
+  //! \return The layer-level properties or the defaults when there are none.
+  const SeSceneLayerData *layerData() const;
+  //! \return The layer-level properties, allocated and detached for writing.
+  SeSceneLayerData *layerData();
+
+  const SeLedCell & cell() const { return mpstore == NULL ? mcell : mpstore->cell(mrow, mcolumn); }
+  SeLedCell & editCell() { return mpstore == NULL ? mcell : mpstore->editCell(mrow, mcolumn); }
+
   QString midentifier;
-  ShapeMode mShapeMode;
+  QSharedDataPointer<SeSceneLayerData> mlayer;
   int mrow;
   int mcolumn;
-  QColor mbrushcolor;
-  QColor mpencolor;
-  TransitionMode mtransitionMode;
-  QString mOriginalFilePath;
-  QPixmap mOriginalPixmap;
-  QSize mSize;
-  QPoint mOffset;
-  QRect mSelectionGeometry;
-  int mScale;
-  bool mEnabled;
-  int mIndex;
-  
+  SeLedCell mcell;
+  SeLedStore *mpstore;
+
   SeSceneItem *powner;
 };
 
@@ -118,6 +224,13 @@ public:
 public:
   int width() { return properties().size().width(); }
   int height() { return properties().size().height(); } 
+
+  //! Cache mode of items created from now on, see SeSceneView::setRenderMode().
+  static void setDefaultCacheMode(CacheMode mode) { sDefaultCacheMode = mode; }
+  static CacheMode defaultCacheMode() { return sDefaultCacheMode; }
+
+private:
+  static CacheMode sDefaultCacheMode;
 };
 
 
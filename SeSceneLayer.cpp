@@ -7,26 +7,57 @@
 // SceneEditor
 #include <SeSceneLayer.h>
 #include <SeSceneItem.h>
+#include <SeSceneLed.h>
 #include <SeGeneral.h>
+#include <SeScene.h>
 
 // Qt
 #include <QPen>
 #include <QUuid>
 #include <QDebug>
+#include <QtMath>
 #include <QPainter>
 #include <QJsonArray>
+#include <QStyleOptionGraphicsItem>
 #include <QSharedPointer>
 
+// C++
+#include <cstring>
+
 SeSceneLayer::SeSceneLayer(int rows, int columns, SeSceneItem *parent)
   : SeSceneItem(parent)
   , mRows(rows)
   , mColumns(columns)
   , mDelay(1.0f)
+  , mLodIsDirty(true)
+  , mRevision(0)
+  , mLowDetail(false)
 {
+  // one identifier per layer, its LEDs derive theirs from it
+  this->setIdentifier(QUuid::createUuid().toString());
 }
 
 SeSceneLayer::~SeSceneLayer()
 {  
+  // QGraphicsItem removes itself from the scene without itemChange()
+  SeScene *pscene = dynamic_cast<SeScene*>(this->scene());
+  if(pscene != NULL) { pscene->unregisterLayer(this); }
+}
+
+QVariant SeSceneLayer::itemChange(GraphicsItemChange change, const QVariant & value)
+{
+  if(change == QGraphicsItem::ItemSceneChange)
+  {
+    SeScene *pscene = dynamic_cast<SeScene*>(this->scene());
+    if(pscene != NULL) { pscene->unregisterLayer(this); }
+  }
+  else if(change == QGraphicsItem::ItemSceneHasChanged)
+  {
+    SeScene *pscene = dynamic_cast<SeScene*>(this->scene());
+    if(pscene != NULL) { pscene->registerLayer(this); }
+  }
+  
+  return SeSceneItem::itemChange(change, value);
 }
 
 void SeSceneLayer::deepCopy(SeSceneLayer *ptrSourceLayer)
@@ -40,16 +71,37 @@ void SeSceneLayer::deepCopy(SeSceneLayer &sourceLayer)
   this->properties() = sourceLayer.properties();
   this->properties().setIdentifier(keepId);
   
+  if(mLeds.rows() == sourceLayer.mLeds.rows() 
+     && mLeds.columns() == sourceLayer.mLeds.columns())
+  {
+    // both layers share the cells until one of them is edited
+    mLeds = sourceLayer.mLeds;
+    
+    // cached LEDs do not notice that their cell changed
+    if(SeSceneItem::defaultCacheMode() != QGraphicsItem::NoCache)
+    {
+      for(QGraphicsItem *item : this->childItems()) { item->update(); }
+    }
+    
+    this->invalidateLod();
+    this->update();
+    return;
+  }
+  
   for(int x=0; x < sourceLayer.numberOfColumns(); x++)
   {
     for(int y=0; y < sourceLayer.numberOfRows(); y++)
     {
       SeSceneItem *p = this->sceneItem(x, y);
+      SE_CONT4NULL(p);
     
       p->properties() = sourceLayer.sceneItem(x, y)->properties();
-      p->properties().setIdentifier(QUuid::createUuid().toString());      
+      // the copy is identified by its own layer and position
+      p->properties().setIdentifier(QString());
     }
   }
+  
+  this->invalidateLod();
 }
 
 void SeSceneLayer::changeShapeMode(SeSceneItemProperties::ShapeMode mode)
@@ -92,7 +144,7 @@ void SeSceneLayer::loadJson(const QJsonObject & jsonObj)
     
     SeSceneItem *pitem = sceneItem(x, y);
     pitem->properties().restore(o["Data"].toObject());
-    pitem->show();
+    pitem->setVisible(mLowDetail == false);
     pitem->update();
   }  
   
@@ -197,6 +249,24 @@ QString SeSceneLayer::toAvrCsv()
   return s;
 }
 
+QVector<QRgb> SeSceneLayer::toRgbBuffer()
+{
+  QVector<QRgb> buffer(this->mRows * this->mColumns, qRgb(0, 0, 0));
+  
+  for(int row=0; row < this->mRows; row++)
+  {
+    for(int col=0; col < this->mColumns; col++)
+    {
+      SeSceneItem *item = this->sceneItem(col, row);
+      SE_CONT4NULL(item);
+      
+      buffer[row * this->mColumns + col] = item->properties().brushColor().rgb();
+    }
+  }
+  
+  return buffer;
+}
+
 QRectF SeSceneLayer::boundingRect() const
 {
   if(isEmpty()) { return QRectF(-1, -1, 5, 5); }
@@ -213,15 +283,101 @@ void SeSceneLayer::paint(
   , const QStyleOptionGraphicsItem *option
   , QWidget *widget
 ) {
-  Q_UNUSED(option);
   Q_UNUSED(widget);
 
+  // the LEDs are hidden, e.g. render() at another scale must not miss them
+  if(mLowDetail)
+  {
+    this->renderGrid(painter, option->exposedRect);
+    return;
+  }
+
+  this->paintBackground(painter);
+  
+  if(isEmpty()) { return; }
+  
+  qreal zoom = option->levelOfDetailFromTransform(painter->worldTransform());
+  if(isLowDetail(mItems[0][0]->width(), zoom))
+  {
+    // the LEDs skip painting, the whole grid is one scaled image
+    this->paintLod(painter);
+  }
+}
+
+void SeSceneLayer::setLowDetail(bool state)
+{
+  if(mLowDetail == state) { return; }
+  
+  mLowDetail = state;
+  
+  // one switch per zoom transition instead of an early return in 
+  // every LED paint, hidden LEDs do not keep their item cache either
+  for(QGraphicsItem *item : this->childItems())
+  {
+    item->setVisible(state == false);
+  }
+  
+  this->update();
+}
+
+void SeSceneLayer::renderGrid(QPainter *painter, const QRectF & exposed)
+{
+  this->paintBackground(painter);
+  
+  if(isEmpty()) { return; }
+
+  const int w = mItems[0][0]->width();
+  const int h = mItems[0][0]->height();
+  
+  qreal zoom = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+  if(isLowDetail(w, zoom))
+  {
+    this->paintLod(painter);
+    return;
+  }
+  
+  // the grid is regular, the exposed LEDs follow from the rect
+  int column0 = 0, column1 = mColumns - 1;
+  int row0 = 0, row1 = mRows - 1;
+  if(exposed.isEmpty() == false)
+  {
+    column0 = qMax(column0, (int) qFloor((exposed.left() - 1) / w));
+    column1 = qMin(column1, (int) qFloor((exposed.right() + 1) / w));
+    row0 = qMax(row0, (int) qFloor((exposed.top() - 1) / h));
+    row1 = qMin(row1, (int) qFloor((exposed.bottom() + 1) / h));
+  }
+  
+  painter->save();
+  painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+  
+  for(int row=row0; row <= row1; row++)
+  {
+    for(int column=column0; column <= column1; column++)
+    {
+      SeSceneItem *item = this->sceneItem(column, row);
+      SE_CONT4NULL(item);
+      
+      const SeSceneItemProperties & p = item->properties();
+      
+      QRectF target = item->boundingRect().translated(item->pos());
+      QPixmap sprite = SeLedAtlas::sprite(p.shapeMode(), p.size(), zoom, false, p.brushRgb(), p.penRgb());
+      painter->drawPixmap(target, sprite, QRectF(sprite.rect()));
+    }
+  }
+  
+  painter->restore();
+}
+
+void SeSceneLayer::paintBackground(QPainter *painter)
+{
   if(isEmpty()) 
   {
     QRectF r = this->boundingRect();
-    painter->setPen(QColor(255, 0, 0));
-    painter->setBrush(QColor(255, 0, 0));
-    painter->drawRect(r);    
+    painter->save();
+      painter->setPen(QColor(255, 0, 0));
+      painter->setBrush(QColor(255, 0, 0));
+      painter->drawRect(r);    
+    painter->restore();
     return;
   }
 
@@ -242,7 +398,29 @@ void SeSceneLayer::paint(
     painter->setBrush(QColor(0, 0, 0));
     painter->drawRect(1, 1, w-2, h-2);
   painter->restore();
+}
+
+void SeSceneLayer::paintLod(QPainter *painter)
+{
+  if(mLodIsDirty || mLodImage.isNull())
+  {
+    QVector<QRgb> buffer = this->toRgbBuffer();
+    
+    mLodImage = QImage(mColumns, mRows, QImage::Format_RGB32);
+    for(int row=0; row < mRows; row++)
+    {
+      memcpy(mLodImage.scanLine(row), buffer.constData() + row * mColumns, mColumns * sizeof(QRgb));
+    }
+    
+    mLodIsDirty = false;
+  }
   
+  SeSceneItem *p = mItems[0][0];
+  
+  painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter->drawImage(QRectF(0, 0, mColumns * p->width(), mRows * p->height()), mLodImage);
+  painter->restore();
 }
 
 SeSceneItem* SeSceneLayer::sceneItem(int x, int y)
@@ -252,3 +430,29 @@ SeSceneItem* SeSceneLayer::sceneItem(int x, int y)
   
   return mItems[y][x];
 }
+
+SeSceneItem* SeSceneLayer::sceneItemAt(const QPointF & pos)
+{
+  if(isEmpty()) { return NULL; }
+  
+  SeSceneItem *p = mItems[0][0];
+  if(p->width() <= 0 || p->height() <= 0) { return NULL; }
+  
+  int x = qFloor(pos.x() / p->width());
+  int y = qFloor(pos.y() / p->height());
+  
+  return this->sceneItem(x, y);
+}
+
+void SeSceneLayer::leds(QList<SeSceneLed*> & leds)
+{
+  for(int y=0; y < mRows; y++)
+  {
+    for(int x=0; x < mColumns; x++)
+    {
+      SeSceneLed *pled = dynamic_cast<SeSceneLed*>(this->sceneItem(x, y));
+      SE_CONT4NULL(pled);
+      leds.append(pled);
+    }
+  }
+}
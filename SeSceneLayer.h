@@ -12,15 +12,25 @@
 // SceneEditor
 #include <SeSceneItem.h>
 
+// forward-declaration
+class SeSceneLed;
+
 // Qt
 #include <QMap>
 #include <QList>
+#include <QRgb>
+#include <QImage>
+#include <QVector>
 #include <QJsonObject>
 #include <QSharedPointer>
 
 #define DEFAULT_ROWS 10      // was 10
 #define DEFAULT_COLUMNS 20   // was 20
 
+//! LEDs smaller than this number of device pixels are not painted 
+//! individually, their layer shows one pixel per LED instead.
+#define SE_LOD_PIXELS 4
+
 /**
  * @brief The SeSceneLayer class
  */
@@ -34,12 +44,12 @@ public:
   friend class SeScenePlayerTransitions;
 
   template<class T> void initialize() {
+    mLeds.resize(mRows, mColumns, SeSceneItemProperties().cell());
     for(int i=0; i < mRows; i++) {
       QList<SeSceneItem*> rowItems;
       for(int j=0; j < mColumns; j++) {
         T *p = new T(this);
-        p->properties().setRow(i);
-        p->properties().setColumn(j);
+        p->properties().setStore(&mLeds, i, j);
         p->setPos(j * p->width(), i * p->height());
         rowItems.append(p);     
       }      
@@ -58,6 +68,28 @@ public:
    
    QString toAvrCsv();
    
+   //! \return The brush colors of all LEDs in row-major order.
+   QVector<QRgb> toRgbBuffer();
+   
+   //! \return True if an LED of \p width units is too small at \p zoom
+   //!         to be painted on its own.
+   static bool isLowDetail(int width, qreal zoom) { return width * zoom < SE_LOD_PIXELS; }
+   
+   //! Marks the low detail image as outdated, e.g. after an LED changed.
+   void invalidateLod() { mLodIsDirty = true; ++mRevision; }
+   
+   //! Hides the LEDs while the view is zoomed out, the layer paints 
+   //! the grid itself then and the LEDs are not traversed at all.
+   void setLowDetail(bool state);
+   
+   //! \return A counter which changes with every LED change.
+   quint32 revision() const { return mRevision; }
+   
+   //! Paints the layer and its LEDs without a scene, used for layers 
+   //! which are not part of any scene like the playback frames. Only 
+   //! LEDs within \p exposed are painted, an empty rect paints all.
+   void renderGrid(QPainter *painter, const QRectF & exposed=QRectF());
+   
    //! Generated and returns the JSON command used for 
    //! deploying this Layer to the Node.js target.
    //! Following format is used for the JSON object:
@@ -81,6 +113,8 @@ public:
 protected:
   QRectF boundingRect() const;
   void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+  //! Registers the layer with the SeScene it is added to.
+  QVariant itemChange(GraphicsItemChange change, const QVariant & value);
       
 public:
   void setDelay(double value) { mDelay = value; }
@@ -97,10 +131,28 @@ private:
   // multi-dimensional field: [y][x] = scene item
   QMap< int, QList< SeSceneItem* > > mItems;
 
+  // state of the LEDs, shared with duplicates of this layer
+  SeLedStore mLeds;
+
+  // one pixel per LED, painted instead of the LEDs when zoomed out
+  QImage mLodImage;
+  bool mLodIsDirty;
+  quint32 mRevision;
+  bool mLowDetail;
+
   bool isEmpty() const { return mItems.count() <= 0; }
 
+  void paintBackground(QPainter *painter);
+  void paintLod(QPainter *painter);
+
 public:
   SeSceneItem* sceneItem(int x, int y);
+  
+  //! \return The LED at \p pos in layer coordinates, NULL outside of the grid.
+  SeSceneItem* sceneItemAt(const QPointF & pos);
+  
+  //! Appends all LEDs in row-major order.
+  void leds(QList<SeSceneLed*> & leds);
 };
 
 #endif // __SESCENELAYER_H__
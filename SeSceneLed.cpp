@@ -6,10 +6,189 @@
 
 // SceneEditor
 #include <SeSceneLed.h>
+#include <SeSceneLayer.h>
 
 // Qt
+#include <QHash>
 #include <QDebug>
+#include <QCache>
+#include <QImage>
+#include <QtMath>
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+// ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+namespace {
+
+  struct SeLedMaskKey
+  {
+    int shapeMode;
+    int width;
+    int height;
+    int zoom;         // in 1/8 steps
+    bool selected;
+
+    bool operator==(const SeLedMaskKey & other) const
+    {
+      return shapeMode == other.shapeMode && width == other.width && height == other.height
+          && zoom == other.zoom && selected == other.selected;
+    }
+  };
+
+  inline uint qHash(const SeLedMaskKey & key, uint seed=0)
+  {
+    return ::qHash((key.width << 16) | key.height, seed) * 17
+         ^ ::qHash((key.zoom << 2) | (key.shapeMode << 1) | (key.selected ? 1 : 0), seed);
+  }
+
+  struct SeLedSpriteKey
+  {
+    SeLedMaskKey mask;
+    QRgb brush;
+    QRgb pen;
+
+    bool operator==(const SeLedSpriteKey & other) const
+    {
+      return mask == other.mask && brush == other.brush && pen == other.pen;
+    }
+  };
+
+  inline uint qHash(const SeLedSpriteKey & key, uint seed=0)
+  {
+    return qHash(key.mask, seed) ^ ::qHash(key.brush, seed) * 31 ^ ::qHash(key.pen, seed);
+  }
+
+  //! White shapes, only their alpha channel is used.
+  struct SeLedMasks
+  {
+    QImage fill;
+    QImage outline;
+    //! Already colored, NULL if the LED is not selected.
+    QImage selection;
+  };
+
+  QCache<SeLedMaskKey, SeLedMasks> & maskCache()
+  {
+    static QCache<SeLedMaskKey, SeLedMasks> cache(SE_LED_MASK_BYTES);
+    return cache;
+  }
+
+  QCache<SeLedSpriteKey, QPixmap> & spriteCache()
+  {
+    static QCache<SeLedSpriteKey, QPixmap> cache(SE_LED_ATLAS_BYTES);
+    return cache;
+  }
+
+  //! \return \p mask colored with \p color where it is opaque.
+  QImage tint(const QImage & mask, QRgb color)
+  {
+    QImage img = mask;
+
+    QPainter painter(&img);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceIn);
+    painter.fillRect(img.rect(), QColor::fromRgba(color));
+    painter.end();
+
+    return img;
+  }
+
+  SeLedMasks masks(const SeLedMaskKey & key)
+  {
+    SeLedMasks *cached = maskCache().object(key);
+    if(cached != NULL) { return *cached; }
+
+    const qreal z = key.zoom / 8.0;
+
+    // covers the bounding rect of the LED, i.e. one unit around its shape
+    QSize size(qCeil((key.width + 2) * z), qCeil((key.height + 2) * z));
+    QRectF r(0, 0, key.width, key.height);
+
+    SeLedMasks m;
+
+    QImage *targets[2] = { &m.fill, &m.outline };
+    for(int i=0; i < 2; i++)
+    {
+      QImage & img = *targets[i];
+      img = QImage(size, QImage::Format_ARGB32_Premultiplied);
+      img.fill(Qt::transparent);
+
+      QPainter painter(&img);
+      painter.setRenderHint(QPainter::Antialiasing, true);
+      painter.setRenderHint(QPainter::HighQualityAntialiasing, true);
+      painter.scale(z, z);
+      painter.translate(1, 1);
+      painter.setBrush(i == 0 ? QBrush(Qt::white) : QBrush(Qt::NoBrush));
+      painter.setPen(i == 0 ? QPen(Qt::NoPen) : QPen(Qt::white));
+
+      switch(key.shapeMode)
+      {
+        case SeSceneItemProperties::ShapeMode::ShapeCircle: painter.drawEllipse(r); break;
+        case SeSceneItemProperties::ShapeMode::ShapeRect: painter.drawRect(r); break;
+      }
+    }
+
+    int bytes = 2 * size.width() * size.height() * 4;
+
+    if(key.selected)
+    {
+      const int w = key.width;
+      const int h = key.height;
+
+      m.selection = QImage(size, QImage::Format_ARGB32_Premultiplied);
+      m.selection.fill(Qt::transparent);
+
+      QPainter painter(&m.selection);
+      painter.setRenderHint(QPainter::Antialiasing, true);
+      painter.scale(z, z);
+      painter.translate(1, 1);
+      painter.setPen(QPen(Qt::red, 1, Qt::DashLine));
+      painter.drawLine(2, 2, w-2, 2);
+      painter.drawLine(w-2, 1, w-2, h-2);
+      painter.drawLine(w-2, h-2, 2, h-2);
+      painter.drawLine(2, h-2, 2, 2);
+
+      bytes += size.width() * size.height() * 4;
+    }
+
+    // QCache deletes objects which exceed its limit right away
+    maskCache().insert(key, new SeLedMasks(m), bytes);
+
+    return m;
+  }
+
+}
+
+QPixmap SeLedAtlas::sprite(int shapeMode, const QSize & size, qreal zoom, bool selected, QRgb brush, QRgb pen)
+{
+  SeLedSpriteKey key;
+  key.mask.shapeMode = shapeMode;
+  key.mask.width = size.width();
+  key.mask.height = size.height();
+  key.mask.zoom = qBound(1, qRound(zoom * 8.0), 64);
+  key.mask.selected = selected;
+  key.brush = brush;
+  key.pen = pen;
+
+  QPixmap *cached = spriteCache().object(key);
+  if(cached != NULL) { return *cached; }
+
+  // a new color costs two fills of the cached masks, the antialiased 
+  // shapes are rasterized once per size and zoom level only
+  const SeLedMasks m = masks(key.mask);
+
+  QImage img = tint(m.fill, brush);
+
+  QPainter painter(&img);
+  painter.drawImage(0, 0, tint(m.outline, pen));
+  if(m.selection.isNull() == false) { painter.drawImage(0, 0, m.selection); }
+  painter.end();
+
+  QPixmap result = QPixmap::fromImage(img);
+  spriteCache().insert(key, new QPixmap(result), img.width() * img.height() * 4);
+
+  return result;
+}
 
 // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
@@ -40,33 +219,28 @@ void SeSceneLed::paint(
   , const QStyleOptionGraphicsItem *option
   , QWidget *widget
 ) {
-  Q_UNUSED(option);
   Q_UNUSED(widget);
   
-  QRectF r(0, 0, properties().size().width(), properties().size().height());
+  // one blit of the pre-rendered sprite at the current device resolution
+  qreal zoom = option->levelOfDetailFromTransform(painter->worldTransform());
   
-  painter->setRenderHint(QPainter::Antialiasing, true);
-  painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
-  painter->setRenderHint(QPainter::HighQualityAntialiasing, true);
-  painter->setBrush(properties().mbrushcolor);
-  painter->setPen(properties().mpencolor);
-  switch(properties().shapeMode())
-  {
-    case SeSceneItemProperties::ShapeMode::ShapeCircle: painter->drawEllipse(r); break;
-    case SeSceneItemProperties::ShapeMode::ShapeRect: painter->drawRect(r); break;
-  }
+  // too small to be seen on its own, the layer paints one pixel instead
+  if(SeSceneLayer::isLowDetail(properties().width(), zoom)) { return; }
   
-  if(isSelected())
-  {
-    painter->save();
-    painter->setPen(QPen(Qt::red, 1, Qt::DashLine));
-    painter->drawLine(2, 2, properties().size().width()-2, 2);
-    painter->drawLine(properties().size().width()-2, 1, properties().size().width()-2, properties().size().height()-2);
-    painter->drawLine(properties().size().width()-2, properties().size().height()-2, 2, properties().size().height()-2);
-    painter->drawLine(2, properties().size().height()-2, 2, 2);
-
-    painter->restore();
-  }
+  QPixmap sprite = SeLedAtlas::sprite(
+        properties().shapeMode()
+      , properties().size()
+      , zoom
+      , isSelected()
+      , properties().brushRgb()
+      , properties().penRgb()
+    );
+  
+  // the view does not save the painter state for each item
+  bool smooth = painter->testRenderHint(QPainter::SmoothPixmapTransform);
+  painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+  painter->drawPixmap(this->boundingRect(), sprite, QRectF(sprite.rect()));
+  painter->setRenderHint(QPainter::SmoothPixmapTransform, smooth);
 }
 
 void SeSceneLed::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
@@ -22,6 +22,29 @@
 class SeSceneLed;
 class SeSceneItemProperties;
 
+//! Upper limit of the memory used by the tinted sprites of SeLedAtlas.
+#define SE_LED_ATLAS_BYTES (32 * 1024 * 1024)
+//! Upper limit of the memory used by the colorless masks of SeLedAtlas.
+#define SE_LED_MASK_BYTES (8 * 1024 * 1024)
+
+/**
+ * @brief The SeLedAtlas class
+ *
+ * Pre-rendered LED sprites. The fill and the outline are rasterized
+ * with antialiasing once per shape, size, zoom level and selection
+ * state as colorless masks. A sprite tints the masks with the colors
+ * of an LED and is kept in a bounded cache, i.e. painting an LED is a
+ * single pixmap blit and a color missing in the cache costs two fills
+ * instead of an antialiased shape. The zoom level is rounded to 1/8 
+ * steps so that zooming does not fill the caches with nearly equal
+ * sprites.
+ */
+class SeLedAtlas
+{
+public:
+  static QPixmap sprite(int shapeMode, const QSize & size, qreal zoom, bool selected, QRgb brush, QRgb pen);
+};
+
 /**
  * @brief The SeSceneLed class
  */
@@ -10,6 +10,9 @@
 #include <SeSceneLayer.h>
 #include <SeSceneLed.h>
 #include <SeScene.h>
+#include <SeGifWriter.h>
+#include <SeApngWriter.h>
+#include <SeVideoWriter.h>
 
 // Qt
 #include <QCoreApplication>
@@ -19,10 +22,13 @@
 #include <QTextStream>
 #include <QStatusBar>
 #include <QDateTime>
+#include <QFileInfo>
 #include <QProcess> 
 #include <QObject>
 #include <QDebug>
+#include <QHash>
 #include <QList>
+#include <QVector>
 #include <QFile>
 #include <QTime>
 #include <QUrl>
@@ -49,7 +55,9 @@ template<class T> T sign(T v[2])
 SeScenePlayerTransitions::SeScenePlayerTransitions(
     QList<SeSceneLayer*> layers
   , SeScenePlayer *owner
-) : mpOwner(owner)
+) : mSourceLayers(layers)
+  , mTotalDuration(0.f)
+  , mpOwner(owner)
 {
   int n = layers.count();
   double td = mpOwner->mMsecDelay / 1000.f;
@@ -93,17 +101,36 @@ SeScenePlayerTransitions::SeScenePlayerTransitions(
     double ttd = tlen / td;           // number of layer for pcurrent
     
     int upperEnd = static_cast<int>(ttd + 0.5f);
-    
-    for(int ml=0; ml < upperEnd; ml += 1)
-    {
-      this->offsets.append(T + ((double) ml * td));
-    }      
       
     int numberOfColumns = pcurrent->mColumns;
     int numberOfRows = pcurrent->mRows;
+    
+    // a layer without any fading LED results in identical frames,
+    // these are stored once and held for the whole layer duration
+    bool isStatic = true;
+    for(int column=0; column < numberOfColumns && isStatic; column++)
+    {
+      for(int row=0; row < numberOfRows; row++)
+      {
+        SeSceneItem *ledCurrent = pcurrent->sceneItem(column, row);
+        SeSceneItem *ledNext = pnext->sceneItem(column, row);
+        SE_CONT4NULL(ledCurrent);
+        SE_CONT4NULL(ledNext);
+        
+        if(ledCurrent->properties().transitionMode() == SeSceneItemProperties::TransitionMode::Fade
+        && ledCurrent->properties().brushColor() != ledNext->properties().brushColor())
+        {
+          isStatic = false;
+          break;
+        }
+      }
+    }
+    
+    int steps = isStatic ? qMin(upperEnd, 1) : upperEnd;
+    int stepHold = isStatic ? upperEnd : 1;
       
     QList<SeSceneLayer*> __steppingLayers;
-    for(int ml=0; ml < upperEnd; ml += 1)
+    for(int ml=0; ml < steps; ml += 1)
     {
       SeSceneLayer *p = new SeSceneLayer(numberOfRows, numberOfColumns);
       p->initialize<SeSceneLed>();
@@ -119,7 +146,7 @@ SeScenePlayerTransitions::SeScenePlayerTransitions(
                     
           if(ledCurrent->properties().transitionMode() == SeSceneItemProperties::TransitionMode::Hard)
           {         
-            for(int ml=0; ml < upperEnd; ml += 1)
+            for(int ml=0; ml < steps; ml += 1)
             {
               SeSceneLayer *__stepLayer = __steppingLayers.at(ml);
               SeSceneLed *__led = (SeSceneLed*) __stepLayer->sceneItem(column, row);            
@@ -152,7 +179,7 @@ SeScenePlayerTransitions::SeScenePlayerTransitions(
           
           //qDebug() << " ---------------------------------------------------- ";
           
-          for(int ml=0; ml < upperEnd; ml += 1)
+          for(int ml=0; ml < steps; ml += 1)
           {
             float r =   red[0] + sign_red   * (d_red   * (float) ml);
             float g = green[0] + sign_green * (d_green * (float) ml);
@@ -179,9 +206,25 @@ SeScenePlayerTransitions::SeScenePlayerTransitions(
       } // for(rows)        
     } // for(columns)
       
+    this->mFirstFrames.append(this->ly.count());
+    
     for(int i=0; i < __steppingLayers.count(); i++)
     {
-      this->ly.append(__steppingLayers.at(i));
+      SeSceneLayer *p = __steppingLayers.at(i);
+    
+      // merge with the previous frame if nothing changed
+      if(this->ly.isEmpty() == false && equalFrames(this->ly.last(), p))
+      {
+        if(i == 0) { this->mFirstFrames.last() -= 1; }
+      
+        this->mHolds.last() += stepHold;
+        delete p;
+        continue;
+      }
+    
+      this->ly.append(p);
+      this->mHolds.append(stepHold);
+      this->offsets.append(T + ((double) i * td));
     }
     
     T += tlen;
@@ -189,39 +232,26 @@ SeScenePlayerTransitions::SeScenePlayerTransitions(
     pbeforeLast = pnext;
   }
   
+  this->mTotalDuration = T;
+  
 #ifdef QT_DEBUG
   qDebug() << "Generated!";
   qDebug() << "  Layer: " << this->ly.count();
+  qDebug() << "  Frames: " << this->numberOfFrames();
   qDebug() << "  Offsets: " << this->offsets.count();
 #endif
 
-  int numberOfLoaded = 0;
-  int numberOfLayer = this->ly.count();
-
-  // add them all to the view
-  for(SeSceneLayer *p : this->ly)
-  {
-    p->hide();
-    mpOwner->mpScene->addItem(p);
-    
-    numberOfLoaded++;
-    
-    float percentage = numberOfLoaded / (float) numberOfLayer * 100.f;
-    
-    QString m = QString("Loading... %1, %2 done...")
-      .arg(percentage)
-      .arg(p->identifier());
-    
-    SceneEditor::__statusBar->showMessage(m);
-    
-    QCoreApplication::processEvents();
-  }
-    
-  ;;
+  // the frames are not added to the scene, they are shown
+  // one at a time by SeScene::setPlaybackLayer()
 }
 
 SeScenePlayerTransitions::~SeScenePlayerTransitions()
 {
+  if(ly.contains(mpOwner->mpScene->playbackLayer()))
+  {
+    mpOwner->mpScene->setPlaybackLayer(NULL);
+  }
+
   for(SeSceneLayer *p : ly)
   {
     delete p;
@@ -229,18 +259,49 @@ SeScenePlayerTransitions::~SeScenePlayerTransitions()
   ly.clear();
 }
 
-bool SeScenePlayerTransitions::update()
+bool SeScenePlayerTransitions::equalFrames(SeSceneLayer *a, SeSceneLayer *b)
 {
-  for(int i=0; i < this->ly.count(); i++)
+  if(a == NULL || b == NULL) { return false; }
+  if(a->numberOfRows() != b->numberOfRows()) { return false; }
+  if(a->numberOfColumns() != b->numberOfColumns()) { return false; }
+  
+  for(int column=0; column < a->numberOfColumns(); column++)
   {
-    SeSceneLayer *p = this->ly.at(i);
-    
-    if(p != NULL)
+    for(int row=0; row < a->numberOfRows(); row++)
     {
-      p->hide();
+      const SeSceneItemProperties & pa = a->sceneItem(column, row)->properties();
+      const SeSceneItemProperties & pb = b->sceneItem(column, row)->properties();
+      
+      if(pa.brushColor() != pb.brushColor()) { return false; }
+      if(pa.penColor() != pb.penColor()) { return false; }
+      if(pa.shapeMode() != pb.shapeMode()) { return false; }
     }
   }
   
+  return true;
+}
+
+int SeScenePlayerTransitions::numberOfFrames() const
+{
+  int n = 0;
+  for(int h : mHolds) { n += h; }
+  return n;
+}
+
+double SeScenePlayerTransitions::duration(int index) const
+{
+  if(index < 0 || index >= offsets.count()) { return 0.f; }
+  
+  if(index + 1 < offsets.count())
+  {
+    return offsets.at(index + 1) - offsets.at(index);
+  }
+  
+  return mTotalDuration - offsets.at(index);
+}
+
+bool SeScenePlayerTransitions::update()
+{
   int & runIndex = mpOwner->mCurrentLayerIndex;
   bool runLooped = mpOwner->mLoop;
 
@@ -259,6 +320,7 @@ bool SeScenePlayerTransitions::update()
   
   if(runIndex >= ly.count() && runLooped == false)
   { 
+    mpOwner->mpScene->setPlaybackLayer(NULL);
     return false;
   }
   
@@ -266,12 +328,7 @@ bool SeScenePlayerTransitions::update()
   
   SceneEditor::__statusBar->showMessage(QString("Scene %1 of %2!").arg(runIndex).arg(ly.count()));
   
-  SeSceneLayer *p = this->ly.at(runIndex);
-  if(p != NULL)
-  {
-    p->show();
-    p->update();
-  }
+  mpOwner->mpScene->setPlaybackLayer(this->ly.at(runIndex));
   
   QCoreApplication::processEvents();
   
@@ -280,6 +337,78 @@ bool SeScenePlayerTransitions::update()
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+SeExportTimeline::SeExportTimeline(
+    const SeScenePlayerTransitions *transitions
+  , int msecDelay
+  , double fps
+  , bool pingPong
+) : mFrameRate(qMax(0.001, fps))
+  , mNumberOfFrames(0)
+{
+  const int n = transitions->layers().count();
+  if(n == 0) { return; }
+
+  // the shown order of the transition frames
+  QList<int> order;
+  for(int i=0; i < n; i++) { order.append(i); }
+  if(pingPong)
+  {
+    for(int i=n - 1; i > 0; --i) { order.append(i); }
+  }
+
+  qint64 totalMsec = 0;
+  for(int index : order) { totalMsec += (qint64) transitions->hold(index) * msecDelay; }
+
+  mNumberOfFrames = qMax(1, qRound(totalMsec * mFrameRate / 1000.0));
+
+  int position = 0;
+  qint64 endMsec = (qint64) transitions->hold(order.at(0)) * msecDelay;
+
+  for(int k=0; k < mNumberOfFrames; k++)
+  {
+    double t = (k + 0.5) * 1000.0 / mFrameRate;
+
+    while(t >= endMsec && position + 1 < order.count())
+    {
+      position++;
+      endMsec += (qint64) transitions->hold(order.at(position)) * msecDelay;
+    }
+
+    int frame = order.at(position);
+
+    if(mEntries.isEmpty() == false && mEntries.last().frame == frame)
+    {
+      mEntries.last().count++;
+    }
+    else
+    {
+      Entry e;
+      e.frame = frame;
+      e.count = 1;
+      mEntries.append(e);
+    }
+  }
+}
+
+QList<int> SeExportTimeline::usedFrames() const
+{
+  int maxFrame = -1;
+  for(const Entry & e : mEntries) { maxFrame = qMax(maxFrame, e.frame); }
+
+  // marks instead of a lookup per entry, long shows have many entries
+  QVector<bool> used(maxFrame + 1, false);
+  for(const Entry & e : mEntries) { used[e.frame] = true; }
+
+  QList<int> frames;
+  for(int i=0; i < used.count(); i++)
+  {
+    if(used.at(i)) { frames.append(i); }
+  }
+  return frames;
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
 SeScenePlayer::SeScenePlayer(SeScene * playerEnvironment, QObject *parent) 
   : QObject(parent)
   , mpScene(playerEnvironment)
@@ -289,6 +418,9 @@ SeScenePlayer::SeScenePlayer(SeScene * playerEnvironment, QObject *parent)
   , mpTransitions(NULL)
   , mpProcess(NULL)
   , mIsVideoGenerating(false)
+  , mAbortIsRequested(false)
+  , mExportFrameRate(0)
+  , mExportPingPong(true)
 {
   QObject::connect(&mTimer, SIGNAL(timeout()), this, SLOT(update()));
   
@@ -315,7 +447,7 @@ bool SeScenePlayer::generateImages(const QString &directoryForImages)
     dir.mkpath(directoryForImages);
   }
   
-  dir.setNameFilters(QStringList() << "image-*.png");
+  dir.setNameFilters(QStringList() << "image-*.png" << SE_FRAME_LIST);
   dir.setFilter(QDir::Files);
   for(int i=0; i < dir.entryList().size(); i++) {
     dir.remove(dir.entryList().at(i));
@@ -323,47 +455,36 @@ bool SeScenePlayer::generateImages(const QString &directoryForImages)
 
   const QList<SeSceneLayer*> & layers = mpTransitions->layers();
   
+  SeExportTimeline timeline(mpTransitions, mMsecDelay, this->exportFrameRate(), mExportPingPong);
+  const QList<int> usedFrames = timeline.usedFrames();
+  
   int numberOfLoaded = 0;
-  int numberOfLayer = layers.count();
-
-  int maxNumber = numberOfLayer * 2;
+  int numberOfLayer = usedFrames.count();
+  
+  auto imageName = [](int index) {
+    return QString("image-%1.png").arg(index, 6, 10, QLatin1Char('0'));
+  };
   
-  auto exportFnc = [&](SeSceneLayer *p) 
+  // every shown frame is rendered once, holds are 
+  // expressed by the durations of the ffmpeg frame list
+  for(int i : usedFrames)
   {
-    QString exportName = QString("%1/image-%2.png")
-                            .arg(directoryForImages)
-                            .arg(numberOfLoaded, 6, 10, QLatin1Char('0'));
-                            
-    mpScene->exportLayer(p, exportName);
+    if(mAbortIsRequested == true) { break; }
+  
+    SeSceneLayer *p = layers.at(i);
+    
+    mpScene->exportLayer(p, QString("%1/%2").arg(directoryForImages).arg(imageName(i)));
     
     numberOfLoaded++;
     
-    float percentage = numberOfLoaded / (float) maxNumber * 100.f;
+    float percentage = numberOfLoaded / (float) numberOfLayer * 100.f;
     
     QString m = QString("Image created %1%, %2 done...")
       .arg(percentage)
       .arg(p->identifier());
     
     SceneEditor::__statusBar->showMessage(m);
-  };
-  
-  // forward
-  for(int i=0; i < numberOfLayer; i++)
-  {
-    if(mAbortIsRequested == true) { break; }
-  
-    SeSceneLayer *p = layers.at(i);  
-    exportFnc(p);
-    QCoreApplication::processEvents();
-  }
-  
-  // backward
-  for(int i=numberOfLayer - 1; i != 0; --i)
-  {
-    if(mAbortIsRequested == true) { break; }
-
-    SeSceneLayer *p = layers.at(i);  
-    exportFnc(p);     
+    
     QCoreApplication::processEvents();
   }
 
@@ -372,6 +493,32 @@ bool SeScenePlayer::generateImages(const QString &directoryForImages)
     mAbortIsRequested = false;    
     return false;
   }
+  
+  QFile frameList(QString("%1/%2").arg(directoryForImages).arg(SE_FRAME_LIST));
+  if(frameList.open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+  {
+    return false;
+  }
+  
+  QTextStream s(&frameList);
+  s << "ffconcat version 1.0\n";
+  
+  const QList<SeExportTimeline::Entry> & entries = timeline.entries();
+  
+  for(int i=0; i < entries.count(); i++)
+  {
+    s << "file '" << imageName(entries.at(i).frame) << "'\n";
+    s << "duration " << QString::number(timeline.duration(i), 'f', 6) << "\n";
+  }
+  
+  // the duration of the last entry is only used if it is followed by a file
+  if(entries.isEmpty() == false)
+  {
+    s << "file '" << imageName(entries.last().frame) << "'\n";
+  }
+  
+  s.flush();
+  frameList.close();
 
   return true;
 }
@@ -387,17 +534,184 @@ bool SeScenePlayer::generateVideo(const QString &videoPath, const QString &direc
 
   mIsVideoGenerating = true;
 
+  bool transitionsCreated = false;
   if(mpTransitions == NULL)
   {
     mpTransitions = new SeScenePlayerTransitions(mLayers, this);
+    transitionsCreated = true;
+  }
+
+  // the built-in writers handle their own formats and replace ffmpeg
+  // when it is missing, an unknown suffix becomes Motion-JPEG AVI then
+  QString ffmpegExe = SeScenePlayer::ffmpegExecutable();
+  QString nativePath;
+
+  if(SeVideoWriter::isSupported(videoPath))
+  {
+    nativePath = videoPath;
+  }
+  else if(ffmpegExe.isEmpty())
+  {
+    QFileInfo info(videoPath);
+    nativePath = info.dir().absoluteFilePath(info.completeBaseName() + ".avi");
+  }
+
+  if(nativePath.isEmpty() == false)
+  {
+    mVideoPath = nativePath;
+    bool res = this->writeVideo(nativePath);
+
+    if(res)
+    {
+      this->processFinished(0, QProcess::NormalExit);
+    }
+    else
+    {
+      mIsVideoGenerating = false;
+    }
+
+    return res;
+  }
 
+  if(transitionsCreated)
+  {
     this->generateImages();
   }
 
+  {
+    qDebug() << "Use ffmpeg version of path: " << ffmpegExe;
+  
+    QString path = directoryOfImages;
+    if(path[path.length()-1] != '/') { path += "/"; }
+    
+    mVideoPath = videoPath;
+    
+    mpProcess->setWorkingDirectory(directoryOfImages);
+    mpProcess->setArguments(QStringList() 
+      << "-y" << "-f" << "concat" << "-safe" << "0" << "-i" << SE_FRAME_LIST 
+      << "-r" << QString::number(this->exportFrameRate(), 'f', 3) << videoPath);
+    mpProcess->setProgram(ffmpegExe);    
+    mpProcess->start();
+  }
+  
+  return true;
+}
+
+bool SeScenePlayer::generateAnimation(const QString & filename)
+{
+  if(mpTransitions == NULL)
+  {
+    mpTransitions = new SeScenePlayerTransitions(mLayers, this);
+  }
+  
+  const QList<SeSceneLayer*> & layers = mpTransitions->layers();
+  if(layers.isEmpty()) { return false; }
+  
+  // same frame order and timing as the video export
+  SeExportTimeline timeline(mpTransitions, mMsecDelay, this->exportFrameRate(), mExportPingPong);
+  const QList<SeExportTimeline::Entry> & entries = timeline.entries();
+  
+  QString suffix = QFileInfo(filename).suffix().toLower();
+  
+  SeAnimationWriter *writer = NULL;
+  if(suffix == "png" || suffix == "apng") { writer = new SeApngWriter(filename); }
+  else { writer = new SeGifWriter(filename); }
+  
+  // every shown transition frame is rendered once
+  const QList<int> usedFrames = timeline.usedFrames();
+  QHash<int, QImage> images;
+  for(int i=0; i < usedFrames.count(); i++)
+  {
+    images.insert(usedFrames.at(i), mpScene->renderLayer(layers.at(usedFrames.at(i))));
+    
+    SceneEditor::__statusBar->showMessage(QString("Rendering frame %1 of %2...").arg(i + 1).arg(usedFrames.count()));
+    QCoreApplication::processEvents();
+  }
+  
+  bool res = true;
+  
+  // delays are rounded on the running time, i.e. they do not drift
+  double elapsed = 0;
+  for(int i=0; i < entries.count() && res; i++)
+  {
+    int start = qRound(elapsed * 1000.0);
+    elapsed += timeline.duration(i);
+    
+    res = writer->addFrame(images.value(entries.at(i).frame), qRound(elapsed * 1000.0) - start);
+  }
+  
+  if(res) { res = writer->finish(); }
+  
+  if(res)
+  {
+    SceneEditor::__statusBar->showMessage(QString("Animation written: %1, %2 frames")
+      .arg(filename).arg(writer->numberOfFrames()));
+  }
+  else
+  {
+    qDebug() << "Animation export failed:" << writer->errorString();
+  }
+  
+  delete writer;
+  
+  return res;
+}
+
+bool SeScenePlayer::writeVideo(const QString & filename)
+{
+  const QList<SeSceneLayer*> & layers = mpTransitions->layers();
+  if(layers.isEmpty()) { return false; }
+
+  SeExportTimeline timeline(mpTransitions, mMsecDelay, this->exportFrameRate(), mExportPingPong);
+  const QList<SeExportTimeline::Entry> & entries = timeline.entries();
+
+  SeVideoWriter *writer = SeVideoWriter::create(filename);
+  if(writer == NULL) { return false; }
+
+  // frames are rendered and written one after another, nothing is kept
+  QImage img = mpScene->renderLayer(layers.at(entries.first().frame));
+  bool res = writer->open(img.size(), timeline.frameRate());
+
+  for(int i=0; i < entries.count() && res; i++)
+  {
+    if(mAbortIsRequested) { res = false; break; }
+
+    SceneEditor::__statusBar->showMessage(QString("Writing frame %1 of %2...").arg(i + 1).arg(entries.count()));
+    QCoreApplication::processEvents();
+
+    if(i > 0) { img = mpScene->renderLayer(layers.at(entries.at(i).frame)); }
+    res = writer->writeFrame(img, entries.at(i).count);
+  }
+  mAbortIsRequested = false;
+
+  if(writer->close() == false) { res = false; }
+
+  if(res && writer->verify() == false)
+  {
+    qDebug() << "Video verification failed:" << filename;
+    res = false;
+  }
+
+  if(res)
+  {
+    qDebug() << "Video written:" << filename << writer->numberOfFrames() << "frames";
+  }
+  else
+  {
+    QMessageBox::critical(NULL, tr("Video export failed"),
+      tr("The video could not be written.\n%1\n%2").arg(filename).arg(writer->errorString()));
+  }
+
+  delete writer;
+
+  return res;
+}
+
+QString SeScenePlayer::ffmpegExecutable()
+{
   QStringList lookUpDirectories;
   
 #ifdef WIN32  
-  QString ffmpegExe("ffmpeg.exe");
   lookUpDirectories << "ffmpeg.exe";
   lookUpDirectories << "ThirdParty/ffmpeg.exe";
   lookUpDirectories << "bin/ffmpeg.exe";
@@ -408,7 +722,6 @@ bool SeScenePlayer::generateVideo(const QString &videoPath, const QString &direc
   lookUpDirectories << QString("%1/Documents/ThirdParty/ffmpeg.exe").arg(QDir::homePath());
   lookUpDirectories << QString("%1/ThirdParty/ffmpeg.exe").arg(QDir::homePath());
 #else
-  QString ffmpegExe("ffmpeg");
   lookUpDirectories << "ffmpeg";
   lookUpDirectories << "ThirdParty/ffmpeg";
   lookUpDirectories << "bin/ffmpeg";
@@ -420,8 +733,6 @@ bool SeScenePlayer::generateVideo(const QString &videoPath, const QString &direc
   lookUpDirectories << QString("%1/ThirdParty/ffmpeg").arg(QDir::homePath());
 #endif
 
-  bool exist = false;
-
   for(int i=0; i < lookUpDirectories.count(); i++)
   {
     QString p = lookUpDirectories.at(i);
@@ -429,35 +740,11 @@ bool SeScenePlayer::generateVideo(const QString &videoPath, const QString &direc
     QFile f(p);
     if(f.exists())
     {
-      ffmpegExe = p;
-      exist = true;
-      break;
+      return p;
     }
   }
   
-  if(exist == false)
-  {
-    QMessageBox::critical(NULL,
-         tr("ffmpeg.exe is missing")
-       , tr("The ffmpeg.exe is missing.\nPath: %1").arg(ffmpegExe)
-      );
-  }
-  else
-  {
-    qDebug() << "Use ffmpeg version of path: " << ffmpegExe;
-  
-    QString path = directoryOfImages;
-    if(path[path.length()-1] != '/') { path += "/"; }
-    
-    mVideoPath = videoPath;
-    
-    mpProcess->setWorkingDirectory(directoryOfImages);
-    mpProcess->setArguments(QStringList() << "-y" << "-r" << "60" << "-i" << "image-%06d.png" << videoPath);
-    mpProcess->setProgram(ffmpegExe);    
-    mpProcess->start();
-  }
-  
-  return true;
+  return QString();
 }
 
 bool SeScenePlayer::abortVideoGeneration()
@@ -565,6 +852,8 @@ void SeScenePlayer::reset()
   mTimer.stop();  
   mCurrentLayerIndex = 0;
   
+  if(mpScene != NULL) { mpScene->setPlaybackLayer(NULL); }
+  
   if(mpTransitions != NULL)
   {
     delete mpTransitions;
@@ -618,8 +907,11 @@ void SeScenePlayer::update()
           
       emit endReached();
     }
-    
-    mpScene->update();
+    else
+    {
+      // the frame stays visible for all of its repetitions
+      mTimer.setInterval(mMsecDelay * mpTransitions->hold(mCurrentLayerIndex));
+    }
   }
   
   QCoreApplication::processEvents();
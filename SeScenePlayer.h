@@ -31,6 +31,15 @@ class SeScenePlayer;
   #define DEFAULT_EXPORT_DIRECTORE "~/exports"
 #endif
 
+// ffmpeg concat list which references the exported images
+#define SE_FRAME_LIST "frames.txt"
+
+#ifdef WIN32
+  #define SE_FFMPEG "ffmpeg.exe"
+#else
+  #define SE_FFMPEG "ffmpeg"
+#endif
+
 /**
  * @brief The SeScenePlayerTransitions class
  */
@@ -46,14 +55,76 @@ public:
   //!         True will be returned.
   bool update();
 
+  //! \return The unique frames, frame i is shown for hold(i) timer steps.
   const QList<SeSceneLayer*> & layers() const { return ly; }
+  
+  //! \return Number of timer steps the frame \p index is shown.
+  int hold(int index) const { return mHolds.at(index); }
+  //! \return Number of timer steps of all frames, i.e. the sum of all holds.
+  int numberOfFrames() const;
+  
+  //! \return The layers the transitions have been generated from.
+  const QList<SeSceneLayer*> & sourceLayers() const { return mSourceLayers; }
+  //! \return Index of the first transition frame of each source layer.
+  const QList<int> & firstFrames() const { return mFirstFrames; }
+  
+  //! \return Start time of the frame \p index in seconds.
+  double offset(int index) const { return offsets.at(index); }
+  //! \return Display duration of the frame \p index in seconds.
+  double duration(int index) const;
+  //! \return Duration of all frames in seconds.
+  double totalDuration() const { return mTotalDuration; }
 
 private:
   QList<double> offsets;
   QList<SeSceneLayer*> ly;
+  QList<int> mHolds;
+  QList<SeSceneLayer*> mSourceLayers;
+  QList<int> mFirstFrames;
+  double mTotalDuration;
+  
+  static bool equalFrames(SeSceneLayer *a, SeSceneLayer *b);
   SeScenePlayer *mpOwner;
 };
 
+/**
+ * @brief The SeExportTimeline class
+ *
+ * Resamples the transitions to a fixed output frame rate. Every
+ * output frame shows the transition frame which is visible at its
+ * center time, consecutive output frames of the same transition
+ * frame are merged into one entry. Transition frames shorter than
+ * an output frame can be skipped and are never rendered.
+ */
+class SeExportTimeline
+{
+public:
+  struct Entry
+  {
+    int frame;    //!< index into SeScenePlayerTransitions::layers()
+    int count;    //!< number of output frames
+  };
+
+  //! \param pingPong Appends the frames backward, as the player does.
+  SeExportTimeline(const SeScenePlayerTransitions *transitions, int msecDelay, double fps, bool pingPong=true);
+
+  double frameRate() const { return mFrameRate; }
+  const QList<Entry> & entries() const { return mEntries; }
+
+  //! \return Number of output frames.
+  int numberOfFrames() const { return mNumberOfFrames; }
+  //! \return Sorted indices of the transition frames which are shown.
+  QList<int> usedFrames() const;
+
+  //! \return Display duration of the entry \p index in seconds.
+  double duration(int index) const { return mEntries.at(index).count / mFrameRate; }
+
+private:
+  double mFrameRate;
+  int mNumberOfFrames;
+  QList<Entry> mEntries;
+};
+
 /**
  * @brief The SeScenePlayer class
  */
@@ -68,6 +139,7 @@ public:
   friend class SeScenePlayerTransitions;
   
   bool setMsecDelay(int msec);
+  int msecDelay() const { return mMsecDelay; }
   void setLoop(bool state) { this->mLoop = state; }
     
   void reset();
@@ -77,11 +149,29 @@ public:
   
   void setLayers(QList<SeSceneLayer*> layers) { mLayers = layers; }
   
+  //! Frame rate of exported videos, by default the player rate.
+  void setExportFrameRate(double fps) { mExportFrameRate = fps; }
+  double exportFrameRate() const { return mExportFrameRate > 0 ? mExportFrameRate : 1000.0 / mMsecDelay; }
+  //! Appends the frames backward to exported videos.
+  void setExportPingPong(bool state) { mExportPingPong = state; }
+  bool exportPingPong() const { return mExportPingPong; }
+
   bool generateImages(const QString & directoryForImages=DEFAULT_EXPORT_DIRECTORE);
+  //! Encodes with ffmpeg, or with a built-in writer for ".y4m", ".rgb" 
+  //! and ".avi" targets. Without ffmpeg any other target is written as 
+  //! Motion-JPEG AVI next to \p videoPath.
   bool generateVideo(const QString & videoPath, const QString & directoryOfImages=DEFAULT_EXPORT_DIRECTORE);
 
   bool abortVideoGeneration();
   
+  //! Writes the transitions as animated GIF or, for a ".png" or 
+  //! ".apng" suffix, as animated PNG without ffmpeg. Frame order and
+  //! timing match generateVideo(), i.e. the same SeExportTimeline.
+  bool generateAnimation(const QString & filename);
+  
+  //! \return Path of the ffmpeg executable, empty if none is found.
+  static QString ffmpegExecutable();
+  
   bool prepareDeployment();
   
 private:
@@ -96,9 +186,16 @@ private:
   bool mIsVideoGenerating;
   bool mAbortIsRequested;
 
+  double mExportFrameRate;
+  bool mExportPingPong;
+
 public:
   bool isVideoGenerating() const { return mIsVideoGenerating; }
 
+private:
+  //! Streams the transitions into \p filename and reads it back.
+  bool writeVideo(const QString & filename);
+
 private slots:
   void processError(QProcess::ProcessError error);
   void processStarted();
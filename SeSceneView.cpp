@@ -12,11 +12,17 @@
 // Qt
 #include <QDebug>
 #include <QGLWidget>
+#include <QPaintEvent>
+#include <QElapsedTimer>
 #include <QGraphicsView>
+#include <QPixmapCache>
+#include <QStyleOptionGraphicsItem>
 
 SeSceneView::SeSceneView(QWidget *parent)
   : QGraphicsView(parent)
   , mpScene(NULL)
+  , mRenderMode(FullRepaint)
+  , mCacheLimit(0)
 {
   this->setViewport(new QGLWidget(QGLFormat(QGL::SampleBuffers)));
   this->setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
@@ -36,5 +42,84 @@ SeSceneView::~SeSceneView()
   
 }
 
+void SeSceneView::setRenderMode(RenderMode mode)
+{
+  mRenderMode = mode;
+
+  QGraphicsItem::CacheMode itemCache = QGraphicsItem::NoCache;
+
+  switch(mode)
+  {
+    case FullRepaint:
+      this->setViewport(new QGLWidget(QGLFormat(QGL::SampleBuffers)));
+      this->setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+      this->setCacheMode(QGraphicsView::CacheNone);
+      this->setOptimizationFlags(QGraphicsView::OptimizationFlags());
+      break;
+    case PartialRepaint:
+      // an OpenGL viewport swaps the whole buffer, partial updates need raster
+      this->setViewport(new QWidget());
+      this->setViewportUpdateMode(QGraphicsView::SmartViewportUpdate);
+      this->setCacheMode(QGraphicsView::CacheBackground);
+      // every item sets its own painter state and has an antialiasing margin
+      this->setOptimizationFlags(QGraphicsView::DontSavePainterState 
+                               | QGraphicsView::DontAdjustForAntialiasing);
+      itemCache = QGraphicsItem::DeviceCoordinateCache;
+      break;
+  }
+
+  SeSceneItem::setDefaultCacheMode(itemCache);
+
+  for(QGraphicsItem *p : mpScene->items())
+  {
+    p->setCacheMode(itemCache);
+  }
+
+  this->updateCacheLimit();
+  this->viewport()->update();
+}
+
+void SeSceneView::updateCacheLimit()
+{
+  if(mRenderMode != PartialRepaint) { return; }
+
+  QList<SeSceneLayer*> layers;
+  mpScene->sceneLayers(layers);
 
+  // the LEDs tile their layer, i.e. one layer area for the LEDs and 
+  // one for the cache of the layer itself, four bytes per pixel
+  qint64 bytes = 0;
+  for(SeSceneLayer *ptr : layers)
+  {
+    SE_CONT4NULL(ptr);
+    if(ptr->isVisible() == false) { continue; }
+    QRectF r = this->transform().mapRect(ptr->sceneBoundingRect());
+    bytes += 2 * 4 * qint64(r.width() + 1) * qint64(r.height() + 1);
+  }
 
+  int limit = int(qBound<qint64>(SE_PIXMAP_CACHE_MIN_KB, bytes / 1024, SE_PIXMAP_CACHE_MAX_KB));
+  if(limit == mCacheLimit) { return; }
+
+  mCacheLimit = limit;
+  QPixmapCache::setCacheLimit(limit);
+}
+
+void SeSceneView::paintEvent(QPaintEvent *event)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  // switches the layers between their LEDs and the low detail image
+  mpScene->setLevelOfDetail(QStyleOptionGraphicsItem::levelOfDetailFromTransform(this->transform()));
+  this->updateCacheLimit();
+
+  QGraphicsView::paintEvent(event);
+
+  int pixels = 0;
+  for(const QRect & r : event->region().rects())
+  {
+    pixels += r.width() * r.height();
+  }
+
+  emit repaintCost(timer.nsecsElapsed() / 1000000.0, pixels);
+}
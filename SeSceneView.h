@@ -17,21 +17,49 @@
 #include <QWidget>
 #include <QGraphicsView>
 
+//! Bounds of QPixmapCache in KB while items use a device coordinate cache.
+#define SE_PIXMAP_CACHE_MIN_KB (10 * 1024)
+#define SE_PIXMAP_CACHE_MAX_KB (256 * 1024)
+
 /**
  * @brief The SeSceneView class
+ *
+ * FullRepaint draws the whole scene on an OpenGL viewport for every
+ * change. PartialRepaint uses a raster viewport which only repaints
+ * the changed regions, all scene items keep their rendering in a 
+ * device coordinate cache and are redrawn only when they change.
  */
 class SeSceneView 
   : public QGraphicsView
 {
   Q_OBJECT
 public:
+  enum RenderMode { FullRepaint=0, PartialRepaint };
+
   SeSceneView(QWidget *parent=0);
   ~SeSceneView();
 
   SeScene *seScene() const { return mpScene; }
+
+  //! Can be changed at any time, the viewport is replaced.
+  void setRenderMode(RenderMode mode);
+  RenderMode renderMode() const { return mRenderMode; }
+
+signals:
+  //! Emitted after each repaint with its duration and painted area.
+  void repaintCost(double msec, int pixels);
+
+protected:
+  void paintEvent(QPaintEvent *event);
   
 private:
   SeScene *mpScene;
+  RenderMode mRenderMode;
+  int mCacheLimit;
+
+  //! Sizes QPixmapCache to the visible layers at the current zoom, the
+  //! item caches of the LEDs and their layer would evict each other otherwise.
+  void updateCacheLimit();
 };
 
 
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeThumbnailCache.h>
+#include <SeSceneLayer.h>
+#include <SeScene.h>
+
+// Qt
+#include <QDir>
+#include <QDebug>
+#include <QDateTime>
+#include <QFile>
+#include <QThread>
+#include <QPainter>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+
+// C++
+#include <cstring>
+
+//! Interval of the check for layers changed after their thumbnail.
+#define SE_THUMBNAIL_CHECK_MSEC 1000
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeThumbnailCache::SeThumbnailCache(SeScene *scene, QObject *parent)
+  : QObject(parent)
+  , mpScene(scene)
+  , mSize(64, 32)
+  , mImages(SE_THUMBNAIL_CACHE_BYTES)
+  , mRunning(0)
+{
+  mDiskPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails";
+  QDir().mkpath(mDiskPath);
+
+  // thumbnails are rendered by this pool only, waiting for it does not
+  // depend on other jobs of the global pool
+  mPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+
+  QtConcurrent::run(&mPool, &SeThumbnailCache::trimDiskCache, mDiskPath);
+
+  QObject::connect(&mRevisionTimer, SIGNAL(timeout()), this, SLOT(checkRevisions()));
+  mRevisionTimer.start(SE_THUMBNAIL_CHECK_MSEC);
+}
+
+SeThumbnailCache::~SeThumbnailCache()
+{
+  mQueue.clear();
+  mPool.waitForDone();
+}
+
+QImage SeThumbnailCache::thumbnail(const QString & identifier)
+{
+  SeSceneLayer *layer = mpScene != NULL ? mpScene->layer(identifier) : NULL;
+  if(layer == NULL || layer->sceneItem(0, 0) == NULL) { return QImage(); }
+
+  QImage *cached = NULL;
+
+  auto it = mEntries.constFind(identifier);
+  if(it != mEntries.constEnd())
+  {
+    cached = mImages.object(it.value().key);
+
+    if(cached != NULL && it.value().revision == layer->revision())
+    {
+      return *cached;
+    }
+  }
+
+  if(mPending.contains(identifier))
+  {
+    // asked again, i.e. still visible, serve it next
+    for(int i=0; i < mQueue.count(); i++)
+    {
+      if(mQueue.at(i).identifier == identifier)
+      {
+        mQueue.move(i, 0);
+        break;
+      }
+    }
+  }
+  else
+  {
+    Request r;
+    r.identifier = identifier;
+    r.revision = layer->revision();
+    r.colors = layer->toRgbBuffer();
+    r.columns = layer->numberOfColumns();
+    r.rows = layer->numberOfRows();
+    r.shapeMode = layer->sceneItem(0, 0)->properties().shapeMode();
+    r.key = contentKey(r, mSize);
+
+    mQueue.prepend(r);
+    mPending.insert(identifier);
+
+    // rows scrolled out of view long ago are asked for again when needed
+    while(mQueue.count() > SE_THUMBNAIL_QUEUE)
+    {
+      mPending.remove(mQueue.takeLast().identifier);
+    }
+
+    this->startJobs();
+  }
+
+  // the outdated thumbnail is better than none
+  return cached != NULL ? *cached : QImage();
+}
+
+void SeThumbnailCache::startJobs()
+{
+  for(int i=0; i < mQueue.count() && mRunning < mPool.maxThreadCount(); )
+  {
+    // the same content is rendered already, loaded from its file afterwards
+    if(mRunningKeys.contains(mQueue.at(i).key)) { i++; continue; }
+
+    Request r = mQueue.takeAt(i);
+
+    QFutureWatcher<Result> *watcher = new QFutureWatcher<Result>(this);
+    QObject::connect(watcher, SIGNAL(finished()), this, SLOT(jobFinished()));
+    watcher->setFuture(QtConcurrent::run(&mPool, &SeThumbnailCache::loadOrRender, r, mDiskPath, mSize));
+
+    mRunningKeys.insert(r.key);
+    mRunning++;
+  }
+}
+
+void SeThumbnailCache::jobFinished()
+{
+  QFutureWatcher<Result> *watcher = dynamic_cast< QFutureWatcher<Result>* >(sender());
+  if(watcher == NULL) { return; }
+
+  Result result = watcher->result();
+  watcher->deleteLater();
+
+  mRunning--;
+  mPending.remove(result.identifier);
+  mRunningKeys.remove(result.key);
+
+  if(result.image.isNull() == false)
+  {
+    Entry e;
+    e.revision = result.revision;
+    e.key = result.key;
+    e.notifiedRevision = result.revision;
+    mEntries.insert(result.identifier, e);
+
+    if(mImages.contains(result.key) == false)
+    {
+      QImage *img = new QImage(result.image);
+      mImages.insert(result.key, img, img->bytesPerLine() * img->height());
+    }
+
+    emit thumbnailReady(result.identifier);
+  }
+
+  this->startJobs();
+}
+
+void SeThumbnailCache::checkRevisions()
+{
+  if(mpScene == NULL) { return; }
+
+  // only layers which have been shown before are of interest
+  for(auto it = mEntries.begin(); it != mEntries.end(); )
+  {
+    SeSceneLayer *layer = mpScene->layer(it.key());
+    if(layer == NULL)
+    {
+      it = mEntries.erase(it);
+      continue;
+    }
+
+    quint32 revision = layer->revision();
+
+    if(revision != it.value().revision 
+       && revision != it.value().notifiedRevision
+       && mPending.contains(it.key()) == false)
+    {
+      // the list asks again if the row is visible, a row out of 
+      // view is notified once per revision only
+      it.value().notifiedRevision = revision;
+      emit thumbnailReady(it.key());
+    }
+
+    ++it;
+  }
+}
+
+QString SeThumbnailCache::contentKey(const Request & request, const QSize & size)
+{
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  hash.addData(QString("%1x%2:%3:%4x%5")
+                 .arg(request.columns).arg(request.rows).arg(request.shapeMode)
+                 .arg(size.width()).arg(size.height()).toLatin1());
+  hash.addData(reinterpret_cast<const char*>(request.colors.constData()), request.colors.count() * sizeof(QRgb));
+
+  return QString::fromLatin1(hash.result().toHex());
+}
+
+SeThumbnailCache::Result SeThumbnailCache::loadOrRender(const Request & request, const QString & diskPath, const QSize & size)
+{
+  Result result;
+  result.identifier = request.identifier;
+  result.revision = request.revision;
+  result.key = request.key;
+
+  QString filename = QString("%1/%2.png").arg(diskPath).arg(result.key);
+
+  if(QFileInfo(filename).exists() && result.image.load(filename, "PNG"))
+  {
+    return result;
+  }
+
+  result.image = render(request.colors, request.columns, request.rows, request.shapeMode, size);
+
+  // written to a temporary file and renamed, a reader never sees half a PNG
+  QSaveFile file(filename);
+  if(file.open(QIODevice::WriteOnly) && result.image.save(&file, "PNG"))
+  {
+    file.commit();
+  }
+
+  return result;
+}
+
+void SeThumbnailCache::trimDiskCache(const QString & diskPath)
+{
+  QDir dir(diskPath);
+  QFileInfoList files = dir.entryInfoList(QStringList() << "*.png", QDir::Files, QDir::Time);
+
+  const QDateTime oldest = QDateTime::currentDateTime().addDays(-SE_THUMBNAIL_DISK_DAYS);
+
+  // sorted by time, the newest file first
+  qint64 bytes = 0;
+  for(const QFileInfo & info : files)
+  {
+    bytes += info.size();
+
+    if(bytes > SE_THUMBNAIL_DISK_BYTES || info.lastModified() < oldest)
+    {
+      QFile::remove(info.absoluteFilePath());
+    }
+  }
+}
+
+QImage SeThumbnailCache::render(const QVector<QRgb> & colors, int columns, int rows, int shapeMode, const QSize & size)
+{
+  if(columns <= 0 || rows <= 0 || colors.count() < columns * rows) { return QImage(); }
+
+  QImage grid(columns, rows, QImage::Format_RGB32);
+  for(int row=0; row < rows; row++)
+  {
+    memcpy(grid.scanLine(row), colors.constData() + row * columns, columns * sizeof(QRgb));
+  }
+
+  QSize target = QSize(columns, rows).scaled(size, Qt::KeepAspectRatio);
+  if(target.isEmpty()) { return QImage(); }
+
+  const qreal ledWidth = target.width() / (qreal) columns;
+  const qreal ledHeight = target.height() / (qreal) rows;
+
+  // rectangles and LEDs of a few pixels do not need any shape
+  if(shapeMode == SeSceneItemProperties::ShapeMode::ShapeRect || ledWidth < SE_LOD_PIXELS)
+  {
+    return grid.scaled(target, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+  }
+
+  QImage image(target, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::black);
+
+  QPainter painter(&image);
+  painter.setRenderHint(QPainter::Antialiasing, true);
+  painter.setPen(Qt::NoPen);
+
+  for(int row=0; row < rows; row++)
+  {
+    const QRgb *line = reinterpret_cast<const QRgb*>(grid.constScanLine(row));
+    for(int column=0; column < columns; column++)
+    {
+      painter.setBrush(QColor(line[column]));
+      painter.drawEllipse(QRectF(column * ledWidth, row * ledHeight, ledWidth, ledHeight));
+    }
+  }
+
+  painter.end();
+
+  return image;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SETHUMBNAILCACHE_H__
+#define __SETHUMBNAILCACHE_H__
+
+// Qt
+#include <QSet>
+#include <QHash>
+#include <QList>
+#include <QRgb>
+#include <QSize>
+#include <QTimer>
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QThreadPool>
+
+// forward-declaration
+class SeScene;
+
+//! Upper limit of the memory used by the thumbnails.
+#define SE_THUMBNAIL_CACHE_BYTES (16 * 1024 * 1024)
+//! Requests beyond this number are dropped, oldest first.
+#define SE_THUMBNAIL_QUEUE 256
+//! Upper limit of the disk cache, the oldest files are removed first.
+#define SE_THUMBNAIL_DISK_BYTES (64 * 1024 * 1024)
+//! Files of the disk cache older than this are removed.
+#define SE_THUMBNAIL_DISK_DAYS 30
+
+/**
+ * @brief The SeThumbnailCache class
+ *
+ * Small previews of the scene layers for the scene list. A thumbnail
+ * is only created when the list asks for it, i.e. for visible rows,
+ * and the most recent request is served first. Rendering runs on a
+ * thread pool of its own from a snapshot of the LED colors, the result
+ * is kept in an LRU bounded memory cache and as PNG in a disk cache 
+ * named by the hash of the content. Requests with the same content,
+ * e.g. of duplicated layers, wait for the running job and load its 
+ * file instead of writing it concurrently. The disk cache is trimmed to its
+ * size and age limits on startup. A changed layer keeps showing its
+ * old thumbnail until the new one is ready.
+ */
+class SeThumbnailCache
+  : public QObject
+{
+  Q_OBJECT
+public:
+  explicit SeThumbnailCache(SeScene *scene, QObject *parent=0);
+  ~SeThumbnailCache();
+
+  void setThumbnailSize(const QSize & size) { mSize = size; }
+  const QSize & thumbnailSize() const { return mSize; }
+
+  //! \return The thumbnail of the layer \p identifier, a null image
+  //!         if none exists yet. Missing or outdated ones are queued.
+  QImage thumbnail(const QString & identifier);
+
+  //! Paints \p colors as grid of \p columns x \p rows LEDs which
+  //! fits into \p size, may be called from any thread.
+  static QImage render(const QVector<QRgb> & colors, int columns, int rows, int shapeMode, const QSize & size);
+
+signals:
+  void thumbnailReady(const QString & identifier);
+
+private slots:
+  void jobFinished();
+  void checkRevisions();
+
+private:
+  struct Request
+  {
+    QString identifier;
+    quint32 revision;
+    QString key;
+    QVector<QRgb> colors;
+    int columns;
+    int rows;
+    int shapeMode;
+  };
+
+  struct Result
+  {
+    QString identifier;
+    quint32 revision;
+    QString key;
+    QImage image;
+  };
+
+  struct Entry
+  {
+    quint32 revision;
+    QString key;
+    //! Last revision thumbnailReady() was emitted for by checkRevisions().
+    quint32 notifiedRevision;
+  };
+
+  SeScene *mpScene;
+  QSize mSize;
+  QString mDiskPath;
+
+  QCache<QString, QImage> mImages;   //!< content key to image
+  QHash<QString, Entry> mEntries;    //!< identifier to content key
+
+  QList<Request> mQueue;             //!< newest request first
+  QSet<QString> mPending;            //!< queued or running identifiers
+  QSet<QString> mRunningKeys;        //!< content keys of the running jobs
+  int mRunning;
+  QTimer mRevisionTimer;
+  QThreadPool mPool;
+
+  void startJobs();
+
+  //! Removes outdated files and the oldest ones beyond the size limit.
+  static void trimDiskCache(const QString & diskPath);
+
+  //! \return The name of the thumbnail in the caches, the hash of the content.
+  static QString contentKey(const Request & request, const QSize & size);
+
+  static Result loadOrRender(const Request & request, const QString & diskPath, const QSize & size);
+};
+
+#endif // __SETHUMBNAILCACHE_H__
@@ -6,73 +6,221 @@
 
 // SceneEditor
 #include <SeTreeScenes.h>
+#include <SeThumbnailCache.h>
 #include <SeGeneral.h>
 
 // Qt
 #include <QUuid>
 #include <QMenu>
 #include <QDebug>
-#include <QTreeWidget>
 #include <QMessageBox>
 #include <QContextMenuEvent>
 
+// C++
+#include <algorithm>
+
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-int SeTreeSceneItem::__instances = 0;
+SeSceneListModel::SeSceneListModel(QObject *parent)
+  : QAbstractListModel(parent)
+  , mInstances(0)
+  , mpThumbnails(NULL)
+  , mRowsAreDirty(false)
+{
+}
+
+void SeSceneListModel::setThumbnailCache(SeThumbnailCache *cache)
+{
+  if(mpThumbnails != NULL) { QObject::disconnect(mpThumbnails, 0, this, 0); }
+  
+  mpThumbnails = cache;
+  
+  if(mpThumbnails != NULL)
+  {
+    QObject::connect(mpThumbnails, SIGNAL(thumbnailReady(QString)), this, SLOT(thumbnailReady(QString)));
+  }
+  
+  if(mEntries.isEmpty() == false)
+  {
+    emit dataChanged(this->index(0), this->index(mEntries.count() - 1), QVector<int>() << Qt::DecorationRole);
+  }
+}
 
-SeTreeSceneItem::SeTreeSceneItem(const QString & uuid)
-  : QTreeWidgetItem()
+void SeSceneListModel::thumbnailReady(const QString & identifier)
 {
-  ++__instances;
+  int row = this->indexOf(identifier);
+  if(row < 0) { return; }
   
-  QString name = QString("Scene %1").arg(__instances);
+  emit dataChanged(this->index(row), this->index(row), QVector<int>() << Qt::DecorationRole);
+}
+
+int SeSceneListModel::rowCount(const QModelIndex & parent) const
+{
+  if(parent.isValid()) { return 0; }
   
-  this->setText(0, name);  
-  this->setData(0, Roles::Uuid, uuid);
+  return mEntries.count();
 }
 
-SeTreeSceneItem::~SeTreeSceneItem()
+QVariant SeSceneListModel::data(const QModelIndex & index, int role) const
 {
+  if(index.isValid() == false || index.row() >= mEntries.count()) { return QVariant(); }
+  
+  const Entry & e = mEntries.at(index.row());
+  
+  switch(role)
+  {
+    case Qt::DisplayRole: return QString("Scene %1").arg(e.number);
+    case Qt::ToolTipRole: return e.identifier;
+    case Qt::DecorationRole:
+      // only asked for rows which are painted, i.e. visible ones
+      if(mpThumbnails != NULL)
+      {
+        QImage img = mpThumbnails->thumbnail(e.identifier);
+        if(img.isNull())
+        {
+          // keeps the row height while the thumbnail is rendered
+          img = QImage(mpThumbnails->thumbnailSize(), QImage::Format_ARGB32_Premultiplied);
+          img.fill(Qt::transparent);
+        }
+        return img;
+      }
+      break;
+    case Roles::Uuid: return e.identifier;
+  }
+  
+  return QVariant();
+}
+
+Qt::ItemFlags SeSceneListModel::flags(const QModelIndex & index) const
+{
+  // scenes are dragged between, never onto each other
+  if(index.isValid() == false) { return Qt::ItemIsDropEnabled; }
+  
+  return QAbstractListModel::flags(index) | Qt::ItemIsDragEnabled;
+}
+
+bool SeSceneListModel::removeRows(int row, int count, const QModelIndex & parent)
+{
+  if(parent.isValid() || row < 0 || count <= 0 || row + count > mEntries.count()) { return false; }
+  
+  this->beginRemoveRows(parent, row, row + count - 1);
+  
+  for(int i=0; i < count; i++)
+  {
+    mEntries.removeAt(row);
+  }
+  mRowsAreDirty = true;
+  
+  this->endRemoveRows();
+  
+  return true;
+}
+
+bool SeSceneListModel::moveRows(
+    const QModelIndex & sourceParent
+  , int sourceRow
+  , int count
+  , const QModelIndex & destinationParent
+  , int destinationChild
+) {
+  if(sourceParent.isValid() || destinationParent.isValid()) { return false; }
+  if(sourceRow < 0 || count <= 0 || sourceRow + count > mEntries.count()) { return false; }
+  if(destinationChild < 0 || destinationChild > mEntries.count()) { return false; }
+  
+  // fails for a destination within the moved rows
+  if(this->beginMoveRows(sourceParent, sourceRow, sourceRow + count - 1, destinationParent, destinationChild) == false)
+  {
+    return false;
+  }
+  
+  QList<Entry> moved = mEntries.mid(sourceRow, count);
+  for(int i=0; i < count; i++) { mEntries.removeAt(sourceRow); }
+  
+  int insertAt = destinationChild > sourceRow ? destinationChild - count : destinationChild;
+  for(int i=0; i < count; i++) { mEntries.insert(insertAt + i, moved.at(i)); }
+  
+  mRowsAreDirty = true;
+  
+  this->endMoveRows();
+  
+  return true;
+}
+
+int SeSceneListModel::append(const QString & identifier)
+{
+  int row = mEntries.count();
+  
+  this->beginInsertRows(QModelIndex(), row, row);
+  
+  Entry e;
+  e.identifier = identifier;
+  e.number = ++mInstances;
+  mEntries.append(e);
+  
+  // appending keeps all other rows
+  if(mRowsAreDirty == false) { mRows.insert(identifier, row); }
+  
+  this->endInsertRows();
+  
+  return row;
+}
+
+void SeSceneListModel::clear()
+{
+  this->beginResetModel();
+  
+  mEntries.clear();
+  mRows.clear();
+  mRowsAreDirty = false;
+  
+  this->endResetModel();
 }
 
-QVariant SeTreeSceneItem::data(int column, int role) const
+QStringList SeSceneListModel::identifiers() const
 {
-  return QTreeWidgetItem::data(column, role);
+  QStringList ids;
+  ids.reserve(mEntries.count());
+  
+  for(const Entry & e : mEntries)
+  {
+    ids.append(e.identifier);
+  }
+  
+  return ids;
 }
 
-void SeTreeSceneItem::setData(int column, int role, const QVariant &value)
+int SeSceneListModel::indexOf(const QString & identifier) const
 {
-  QTreeWidgetItem::setData(column, role, value);
+  if(mRowsAreDirty)
+  {
+    mRows.clear();
+    for(int i=0; i < mEntries.count(); i++)
+    {
+      mRows.insert(mEntries.at(i).identifier, i);
+    }
+    mRowsAreDirty = false;
+  }
+  
+  return mRows.value(identifier, -1);
 }
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 SeTreeScenes::SeTreeScenes(QWidget *parent)
-  : QTreeWidget(parent)
+  : QListView(parent)
+  , mpModel(new SeSceneListModel(this))
 {
+  this->setModel(mpModel);
+  
+  // all rows have the same height, the view does not need to ask for each
+  this->setUniformItemSizes(true);
   this->setSelectionMode(QAbstractItemView::SingleSelection);
   this->setDragEnabled(true);
   this->setDropIndicatorShown(true);
   this->setDragDropMode(QAbstractItemView::InternalMove);
   
-  QObject::connect(this, &SeTreeScenes::itemClicked, [=](QTreeWidgetItem *item, int column){
-    QString identifier = item->data(column, SeTreeSceneItem::Roles::Uuid).toString();
-    if(identifier.isEmpty() == false)
-    {
-      emit sceneLayerClicked(identifier);
-    }
-  });
-  
-  //QObject::connect(this, &SeTreeScenes::itemActivated, [=](QTreeWidgetItem *item, int column){
-  //  QString identifier = item->data(column, SeTreeSceneItem::Roles::Uuid).toString();
-  //  if(identifier.isEmpty() == false)
-  //  {
-  //    emit sceneLayerClicked(identifier);
-  //  }
-  //});
-  
-  QObject::connect(this, &SeTreeScenes::itemChanged, [=](QTreeWidgetItem *item, int column){
-    QString identifier = item->data(column, SeTreeSceneItem::Roles::Uuid).toString();
+  QObject::connect(this, &SeTreeScenes::clicked, [=](const QModelIndex & index){
+    QString identifier = index.data(SeSceneListModel::Roles::Uuid).toString();
     if(identifier.isEmpty() == false)
     {
       emit sceneLayerClicked(identifier);
@@ -84,52 +232,33 @@ SeTreeScenes::~SeTreeScenes()
 {
 }
 
-QStringList SeTreeScenes::identifiers()
+void SeTreeScenes::setThumbnailCache(SeThumbnailCache *cache)
 {
-  QStringList ids;
-
-  QTreeWidgetItemIterator it(this);
-  while(*it)
-  {
-    SeTreeSceneItem *treeSceneItem = dynamic_cast<SeTreeSceneItem*>(*it);
-    if(treeSceneItem == NULL) 
-    {
-      // ...
-    }
-    else
-    {  
-      ids.append(treeSceneItem->data(0, SeTreeSceneItem::Roles::Uuid).toString());
-    }
-    
-    ++it;
-  }
+  if(cache != NULL) { this->setIconSize(cache->thumbnailSize()); }
   
-  return ids;
+  mpModel->setThumbnailCache(cache);
 }
 
-int SeTreeScenes::indexOf(const QString &identifier)
+QString SeTreeScenes::currentIdentifier() const
 {
-  int indexPos = -1;
+  return this->currentIndex().data(SeSceneListModel::Roles::Uuid).toString();
+}
 
-  QStringList ids = this->identifiers();
-  for(int i=0; i < ids.count(); i++)
-  {
-    qDebug() << QString("%1: %2").arg(i).arg(ids.at(i));
-    
-    if(ids.at(i) == identifier)
-    {
-      indexPos = i;
-    }
-  }
+void SeTreeScenes::setCurrentScene(const QString & identifier)
+{
+  int row = mpModel->indexOf(identifier);
+  if(row < 0) { return; }
   
-  return indexPos;
+  this->setCurrentIndex(mpModel->index(row));
+  
+  emit sceneLayerClicked(identifier);
 }
 
 void SeTreeScenes::contextMenuEvent(QContextMenuEvent *e)
 {
-  QTreeWidgetItem *ptrItem = this->itemAt(e->pos());
+  QModelIndex index = this->indexAt(e->pos());
 
-  if(ptrItem != NULL)
+  if(index.isValid())
   {
     QMenu m;
     
@@ -159,17 +288,50 @@ void SeTreeScenes::contextMenuEvent(QContextMenuEvent *e)
 
 void SeTreeScenes::keyPressEvent(QKeyEvent *e)
 {
-  QTreeWidget::keyPressEvent(e);
+  QListView::keyPressEvent(e);
 }
 
 void SeTreeScenes::keyReleaseEvent(QKeyEvent *e)
 {
-  emit sceneLayerClicked(this->currentItem()->data(0, SeTreeSceneItem::Roles::Uuid).toString());
+  QString identifier = this->currentIdentifier();
+  if(identifier.isEmpty() == false)
+  {
+    emit sceneLayerClicked(identifier);
+  }
+  
+  QListView::keyReleaseEvent(e);
+}
+
+void SeTreeScenes::dropEvent(QDropEvent *e)
+{
+  QModelIndex source = this->currentIndex();
+  
+  if(e->source() != this || source.isValid() == false)
+  {
+    e->ignore();
+    return;
+  }
+  
+  int row = mpModel->rowCount();
   
-  QTreeWidget::keyReleaseEvent(e);
+  QModelIndex target = this->indexAt(e->pos());
+  if(target.isValid())
+  {
+    row = target.row();
+    if(this->dropIndicatorPosition() == QAbstractItemView::BelowItem) { row++; }
+  }
+  
+  mpModel->moveRow(QModelIndex(), source.row(), QModelIndex(), row);
+  
+  // the row has been moved already, a move action would remove the source
+  e->setDropAction(Qt::CopyAction);
+  e->accept();
+  
+  this->setState(QAbstractItemView::NoState);
+  this->viewport()->update();
 }
 
-SeTreeSceneItem *SeTreeScenes::addScene(
+QString SeTreeScenes::addScene(
     const QString & identifier
   , bool informEnvironment
 ) {
@@ -184,17 +346,17 @@ SeTreeSceneItem *SeTreeScenes::addScene(
   {
     id = identifier;
   }
-  SeTreeSceneItem *p = new SeTreeSceneItem(id);
-  this->addTopLevelItem(p);
-  this->setCurrentItem(p);
+  
+  int row = mpModel->append(id);
+  this->setCurrentIndex(mpModel->index(row));
   
   if(informEnvironment == true)
   {
-    emit createScene(p->data(0, SeTreeSceneItem::Roles::Uuid).toString());
+    emit createScene(id);
   }
-  emit sceneLayerClicked(p->data(0, SeTreeSceneItem::Roles::Uuid).toString());  
+  emit sceneLayerClicked(id);  
 
-  return p;
+  return id;
 }
 
 bool SeTreeScenes::removeScene()
@@ -210,14 +372,17 @@ bool SeTreeScenes::removeScene()
     return false;
   }
 
-  QList<QTreeWidgetItem*> items = this->selectedItems();
-  for(QTreeWidgetItem *p : items)
+  QModelIndexList indexes = this->selectionModel()->selectedRows();
+  
+  // from the bottom, the rows above keep their position
+  std::sort(indexes.begin(), indexes.end(), [](const QModelIndex & a, const QModelIndex & b) {
+    return a.row() > b.row();
+  });
+  
+  for(const QModelIndex & index : indexes)
   {
-    SE_CONT4NULL(p);
-    SeTreeSceneItem *pitem = dynamic_cast<SeTreeSceneItem*>(p);
-    SE_CONT4NULL(pitem);    
-    QString id = pitem->data(0, SeTreeSceneItem::Roles::Uuid).toString();
-    SE_DELETE(p);    
+    QString id = index.data(SeSceneListModel::Roles::Uuid).toString();
+    mpModel->removeRow(index.row());
     emit removeScene(id);
   }
   
@@ -226,22 +391,17 @@ bool SeTreeScenes::removeScene()
 
 bool SeTreeScenes::duplicateScene()
 {
-  QList<QTreeWidgetItem*> items = this->selectedItems();
+  QStringList sources;
+  for(const QModelIndex & index : this->selectionModel()->selectedRows())
+  {
+    sources.append(index.data(SeSceneListModel::Roles::Uuid).toString());
+  }
 
-  for(QTreeWidgetItem *p : items)
+  for(const QString & srcUuid : sources)
   {
-    SE_CONT4NULL(p);   
-    SeTreeSceneItem *pitem = dynamic_cast<SeTreeSceneItem*>(p);
-    SE_CONT4NULL(pitem);
-        
-    SeTreeSceneItem *pitemNew = this->addScene("", false);
-    if(pitemNew != NULL)
-    {        
-      qDebug() << "New item: " << pitemNew->data(0, SeTreeSceneItem::Roles::Uuid).toString();
-    }
-        
-    QString srcUuid = pitem->data(0, SeTreeSceneItem::Roles::Uuid).toString();
-    QString dstUuid = pitemNew->data(0, SeTreeSceneItem::Roles::Uuid).toString(); 
+    QString dstUuid = this->addScene("", false);
+    
+    qDebug() << "New item: " << dstUuid;
         
     emit duplicateScene(srcUuid, dstUuid);
   }
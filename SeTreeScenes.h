@@ -10,59 +10,114 @@
 #define __SETREESCENES_H__
 
 // Qt
+#include <QHash>
+#include <QList>
 #include <QDebug>
 #include <QWidget>
 #include <QMdiArea>
 #include <QKeyEvent>
+#include <QListView>
+#include <QDropEvent>
 #include <QJsonArray>
 #include <QStringList>
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
+#include <QAbstractListModel>
+
+// forward-declaration
+class SeThumbnailCache;
 
 /**
- * @brief The SeTreeSceneItem class
+ * @brief The SeSceneListModel class
+ *
+ * Flat list of the scene identifiers in playing order. The display
+ * name is created on request from a running number, the row of an
+ * identifier is looked up in a hash which is rebuilt after rows have 
+ * been moved or removed.
  */
-class SeTreeSceneItem
-  : public QTreeWidgetItem
+class SeSceneListModel
+  : public QAbstractListModel
 {
+  Q_OBJECT
 public:
-  explicit SeTreeSceneItem(const QString & uuid);
-  ~SeTreeSceneItem();
+  explicit SeSceneListModel(QObject *parent = 0);
   
   enum Roles {
     Uuid = Qt::UserRole + 1
   };
   
-public:
-  static void resetInstanceCounter() { __instances = 0; }
+  int rowCount(const QModelIndex & parent = QModelIndex()) const;
+  QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+  Qt::ItemFlags flags(const QModelIndex & index) const;
+  Qt::DropActions supportedDropActions() const { return Qt::MoveAction; }
+  
+  bool removeRows(int row, int count, const QModelIndex & parent = QModelIndex());
+  bool moveRows(const QModelIndex & sourceParent, int sourceRow, int count, 
+                const QModelIndex & destinationParent, int destinationChild);
+  
+  //! \return The row of the appended scene.
+  int append(const QString & identifier);
+  void clear();
+  
+  QString identifier(int row) const { return mEntries.at(row).identifier; }
+  QStringList identifiers() const;
+  
+  //! \return Row of \p identifier, -1 if it is unknown.
+  int indexOf(const QString & identifier) const;
+  
+  //! Restarts the numbering of the display names.
+  void resetInstanceCounter() { mInstances = 0; }
+  
+  //! Source of the decoration of each row, NULL shows names only.
+  void setThumbnailCache(SeThumbnailCache *cache);
+  
+private slots:
+  void thumbnailReady(const QString & identifier);
   
 private:
-  static int __instances;  
-    
-public:
-  QVariant data(int column, int role) const;
-  void setData(int column, int role, const QVariant &value);  
+  struct Entry
+  {
+    QString identifier;
+    int number;
+  };
+  
+  QList<Entry> mEntries;
+  int mInstances;
+  SeThumbnailCache *mpThumbnails;
+  
+  mutable QHash<QString, int> mRows;
+  mutable bool mRowsAreDirty;
 };
 
 /**
  * @brief The SeTreeScenes class
  */
 class SeTreeScenes 
-  : public QTreeWidget
+  : public QListView
 {
   Q_OBJECT
 public:
   explicit SeTreeScenes(QWidget *parent = 0);
   ~SeTreeScenes();
   
-  QStringList identifiers();
+  SeSceneListModel *sceneModel() const { return mpModel; }
+  
+  QStringList identifiers() const { return mpModel->identifiers(); }
+  
+  int indexOf(const QString & identifier) const { return mpModel->indexOf(identifier); }
+  
+  int count() const { return mpModel->rowCount(); }
   
-  int indexOf(const QString & identifier);
+  void clear() { mpModel->clear(); }
+  
+  void setThumbnailCache(SeThumbnailCache *cache);
+  
+  //! Selects \p identifier and announces it by sceneLayerClicked().
+  void setCurrentScene(const QString & identifier);
   
 protected:
   void contextMenuEvent(QContextMenuEvent *e); 
   void keyPressEvent(QKeyEvent *e); 
   void keyReleaseEvent(QKeyEvent *e);
+  void dropEvent(QDropEvent *e);
   
 signals:
   void sceneLayerClicked(const QString & identifier);
@@ -71,9 +126,15 @@ signals:
   void duplicateScene(const QString & existingIdentifier, const QString & createdIdentifier);
       
 public slots:
-  SeTreeSceneItem *addScene(const QString & identifier="", bool informEnvironment=true);
+  //! \return The identifier of the added scene.
+  QString addScene(const QString & identifier="", bool informEnvironment=true);
   bool removeScene();
   bool duplicateScene();
+  
+private:
+  SeSceneListModel *mpModel;
+  
+  QString currentIdentifier() const;
 };
 
 #endif // __SETREESCENES_H__
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeVideoImporter.h>
+#include <SeScenePlayer.h>
+#include <SeSceneLayer.h>
+
+// Qt
+#include <QDebug>
+#include <QThread>
+#include <QProcess>
+#include <QtConcurrent>
+#include <QCoreApplication>
+#include <QRegularExpression>
+
+//! Used when ffmpeg does not report the frame rate of the input.
+#define SE_IMPORT_FRAME_RATE 10.0
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeVideoImporter::SeVideoImporter(QObject *parent)
+  : QObject(parent)
+  , mColumns(DEFAULT_COLUMNS)
+  , mRows(DEFAULT_ROWS)
+  , mMaxFrameRate(SE_IMPORT_FRAME_RATE)
+  , mFrameRate(0)
+  , mAbortIsRequested(false)
+{
+}
+
+void SeVideoImporter::setGridSize(int columns, int rows)
+{
+  mColumns = qMax(1, columns);
+  mRows = qMax(1, rows);
+}
+
+bool SeVideoImporter::import(const QString & filename)
+{
+  mFrames.clear();
+  mErrorString.clear();
+  mAbortIsRequested = false;
+
+  QString ffmpegExe = SeScenePlayer::ffmpegExecutable();
+  if(ffmpegExe.isEmpty())
+  {
+    mErrorString = tr("The ffmpeg.exe is missing.\nPath: %1").arg(SE_FFMPEG);
+    return false;
+  }
+
+  double sourceRate = probeFrameRate(ffmpegExe, filename);
+  if(sourceRate <= 0) { sourceRate = SE_IMPORT_FRAME_RATE; }
+
+  mFrameRate = qMin(sourceRate, mMaxFrameRate);
+
+  const int blockSize = mFilter.blockSize();
+  const int width = mColumns * blockSize;
+  const int height = mRows * blockSize;
+  const int frameBytes = width * height * 3;
+
+  QProcess process;
+  process.setProgram(ffmpegExe);
+  process.setArguments(QStringList()
+    << "-hide_banner" << "-loglevel" << "error"
+    << "-i" << filename
+    << "-vf" << QString("fps=%1,scale=%2:%3").arg(mFrameRate, 0, 'f', 3).arg(width).arg(height)
+    << "-f" << "rawvideo" << "-pix_fmt" << "rgb24" << "-");
+  process.start();
+
+  if(process.waitForStarted() == false)
+  {
+    mErrorString = process.errorString();
+    return false;
+  }
+
+  qDebug() << "Importing video:" << filename << "at" << mFrameRate << "fps," << width << "x" << height;
+
+  // frames are filtered in order of arrival, the oldest result is
+  // collected first so that the decoder cannot run away
+  QList< QFuture<QImage> > pending;
+  const int maxPending = qMax(2, 2 * QThread::idealThreadCount());
+
+  auto collect = [&](int keep) {
+    while(pending.count() > keep)
+    {
+      mFrames.append(pending.takeFirst().result());
+      emit progress(mFrames.count());
+      QCoreApplication::processEvents();
+    }
+  };
+
+  QByteArray buffer;
+
+  while(true)
+  {
+    if(mAbortIsRequested)
+    {
+      process.kill();
+      process.waitForFinished();
+      break;
+    }
+
+    bool running = process.state() != QProcess::NotRunning;
+    if(running) { process.waitForReadyRead(100); }
+
+    buffer += process.readAllStandardOutput();
+
+    while(buffer.size() >= frameBytes)
+    {
+      pending.append(QtConcurrent::run( &SeVideoImporter::filterFrame
+                                      , buffer.left(frameBytes)
+                                      , width, height, mFilter));
+      buffer.remove(0, frameBytes);
+
+      collect(maxPending);
+    }
+
+    if(running == false) { break; }
+  }
+
+  collect(0);
+
+  if(mFrames.isEmpty())
+  {
+    mErrorString = QString::fromLocal8Bit(process.readAllStandardError()).trimmed();
+    if(mErrorString.isEmpty()) { mErrorString = tr("No frames decoded from %1").arg(filename); }
+    return false;
+  }
+
+  return mAbortIsRequested == false;
+}
+
+double SeVideoImporter::probeFrameRate(const QString & ffmpegExe, const QString & filename)
+{
+  // without an output ffmpeg only prints the stream information
+  QProcess process;
+  process.start(ffmpegExe, QStringList() << "-hide_banner" << "-i" << filename);
+  if(process.waitForFinished(10000) == false)
+  {
+    process.kill();
+    process.waitForFinished();
+    return 0;
+  }
+
+  QString info = QString::fromLocal8Bit(process.readAllStandardError());
+
+  QRegularExpressionMatch m = QRegularExpression("Video:.*?(\\d+(?:\\.\\d+)?) fps").match(info);
+  if(m.hasMatch() == false) { return 0; }
+
+  return m.captured(1).toDouble();
+}
+
+QImage SeVideoImporter::filterFrame(const QByteArray & rgb, int width, int height, SeMosaicFilter filter)
+{
+  QImage img(reinterpret_cast<const uchar*>(rgb.constData()), width, height, width * 3, QImage::Format_RGB888);
+
+  return filter.grid(img);
+}
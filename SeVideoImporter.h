@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SEVIDEOIMPORTER_H__
+#define __SEVIDEOIMPORTER_H__
+
+// SceneEditor
+#include <SeMosaicFilter.h>
+
+// Qt
+#include <QList>
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <QFuture>
+#include <QByteArray>
+
+/**
+ * @brief The SeVideoImporter class
+ *
+ * Decodes a video with ffmpeg into LED grids. ffmpeg scales every
+ * frame to the grid size times the mosaic block size and writes raw
+ * RGB24 to its standard output, the frames are reduced to one color
+ * per LED by the mosaic filter on the global thread pool. The frame
+ * rate is limited to maxFrameRate(), i.e. to what the player can show.
+ */
+class SeVideoImporter
+  : public QObject
+{
+  Q_OBJECT
+public:
+  explicit SeVideoImporter(QObject *parent=0);
+
+  void setGridSize(int columns, int rows);
+  int columns() const { return mColumns; }
+  int rows() const { return mRows; }
+
+  //! Filter which reduces a frame to the grid, its block size
+  //! determines the resolution requested from ffmpeg.
+  void setFilter(const SeMosaicFilter & filter) { mFilter = filter; }
+  const SeMosaicFilter & filter() const { return mFilter; }
+
+  void setMaxFrameRate(double fps) { mMaxFrameRate = fps; }
+  double maxFrameRate() const { return mMaxFrameRate; }
+
+  //! Decodes \p filename, blocks until all frames are processed.
+  //! \return False if ffmpeg is missing or did not deliver any frame.
+  bool import(const QString & filename);
+
+  //! \return One image of columns() x rows() pixels per frame.
+  const QList<QImage> & frames() const { return mFrames; }
+
+  //! \return Frame rate of the imported frames.
+  double frameRate() const { return mFrameRate; }
+
+  const QString & errorString() const { return mErrorString; }
+
+public slots:
+  void abort() { mAbortIsRequested = true; }
+
+signals:
+  void progress(int frames);
+
+private:
+  int mColumns;
+  int mRows;
+  double mMaxFrameRate;
+  double mFrameRate;
+  bool mAbortIsRequested;
+
+  SeMosaicFilter mFilter;
+  QList<QImage> mFrames;
+  QString mErrorString;
+
+  //! Parses the frame rate ffmpeg reports for \p filename.
+  static double probeFrameRate(const QString & ffmpegExe, const QString & filename);
+
+  static QImage filterFrame(const QByteArray & rgb, int width, int height, SeMosaicFilter filter);
+};
+
+#endif // __SEVIDEOIMPORTER_H__
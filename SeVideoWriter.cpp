@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+// SceneEditor
+#include <SeVideoWriter.h>
+
+// Qt
+#include <QDebug>
+#include <QBuffer>
+#include <QFileInfo>
+#include <QTextStream>
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeVideoWriter::SeVideoWriter(const QString & filename)
+  : mFilename(filename)
+  , mFile(filename)
+  , mRate(10)
+  , mScale(1)
+  , mNumberOfFrames(0)
+{
+}
+
+SeVideoWriter::~SeVideoWriter()
+{
+  if(mFile.isOpen()) { mFile.close(); }
+}
+
+bool SeVideoWriter::isSupported(const QString & filename)
+{
+  QString suffix = QFileInfo(filename).suffix().toLower();
+
+  return suffix == "y4m" || suffix == "rgb" || suffix == "raw" || suffix == "avi";
+}
+
+SeVideoWriter *SeVideoWriter::create(const QString & filename)
+{
+  QString suffix = QFileInfo(filename).suffix().toLower();
+
+  if(suffix == "y4m") { return new SeY4mWriter(filename); }
+  if(suffix == "rgb" || suffix == "raw") { return new SeRawVideoWriter(filename); }
+  if(suffix == "avi") { return new SeMjpegAviWriter(filename); }
+
+  return NULL;
+}
+
+bool SeVideoWriter::open(const QSize & size, double fps)
+{
+  mSize = size;
+  mRate = qMax(1, qRound(fps * 1000.0));
+  mScale = 1000;
+  mNumberOfFrames = 0;
+
+  // e.g. 25000/1000 becomes 25/1
+  int a = mRate, b = mScale;
+  while(b != 0) { int t = a % b; a = b; b = t; }
+  mRate /= a;
+  mScale /= a;
+
+  if(mFile.open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+  {
+    mErrorString = mFile.errorString();
+    return false;
+  }
+
+  return this->writeHeader();
+}
+
+bool SeVideoWriter::writeFrame(const QImage & image, int repeat)
+{
+  if(mFile.isOpen() == false || repeat <= 0) { return false; }
+
+  if(image.size() != mSize)
+  {
+    mErrorString = QString("Frame size %1x%2 differs from %3x%4")
+      .arg(image.width()).arg(image.height())
+      .arg(mSize.width()).arg(mSize.height());
+    return false;
+  }
+
+  if(this->writeImage(image.convertToFormat(QImage::Format_RGB32), repeat) == false)
+  {
+    return false;
+  }
+
+  mNumberOfFrames += repeat;
+  return true;
+}
+
+bool SeVideoWriter::close()
+{
+  if(mFile.isOpen() == false) { return false; }
+
+  bool res = this->writeTrailer();
+  mFile.close();
+
+  return res;
+}
+
+bool SeVideoWriter::write(const QByteArray & data)
+{
+  if(mFile.write(data) != data.size())
+  {
+    mErrorString = mFile.errorString();
+    return false;
+  }
+  return true;
+}
+
+void SeVideoWriter::appendU16LE(QByteArray & out, int v)
+{
+  out.append((char) (v & 0xff));
+  out.append((char) ((v >> 8) & 0xff));
+}
+
+void SeVideoWriter::appendU32LE(QByteArray & out, quint32 v)
+{
+  out.append((char) (v & 0xff));
+  out.append((char) ((v >> 8) & 0xff));
+  out.append((char) ((v >> 16) & 0xff));
+  out.append((char) ((v >> 24) & 0xff));
+}
+
+quint32 SeVideoWriter::readU32LE(const char *p)
+{
+  const uchar *u = reinterpret_cast<const uchar*>(p);
+  return u[0] | (u[1] << 8) | (u[2] << 16) | ((quint32) u[3] << 24);
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeY4mWriter::SeY4mWriter(const QString & filename)
+  : SeVideoWriter(filename)
+{
+}
+
+int SeY4mWriter::frameBytes() const
+{
+  int w = mSize.width();
+  int h = mSize.height();
+  return w * h + 2 * (((w + 1) / 2) * ((h + 1) / 2));
+}
+
+bool SeY4mWriter::writeHeader()
+{
+  QString header = QString("YUV4MPEG2 W%1 H%2 F%3:%4 Ip A1:1 C420jpeg\n")
+    .arg(mSize.width()).arg(mSize.height())
+    .arg(mRate).arg(mScale);
+
+  return this->write(header.toLatin1());
+}
+
+bool SeY4mWriter::writeImage(const QImage & image, int repeat)
+{
+  const int w = mSize.width();
+  const int h = mSize.height();
+  const int cw = (w + 1) / 2;
+  const int ch = (h + 1) / 2;
+
+  QByteArray frame("FRAME\n");
+  const int headerSize = frame.size();
+  frame.resize(headerSize + this->frameBytes());
+
+  uchar *y = reinterpret_cast<uchar*>(frame.data()) + headerSize;
+  uchar *u = y + w * h;
+  uchar *v = u + cw * ch;
+
+  for(int iy=0; iy < h; iy++)
+  {
+    const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(iy));
+    for(int ix=0; ix < w; ix++)
+    {
+      QRgb c = line[ix];
+      y[iy * w + ix] = (uchar) (((66 * qRed(c) + 129 * qGreen(c) + 25 * qBlue(c) + 128) >> 8) + 16);
+    }
+  }
+
+  // chroma of the mean color of every 2x2 block
+  for(int cy=0; cy < ch; cy++)
+  {
+    const QRgb *line0 = reinterpret_cast<const QRgb*>(image.constScanLine(2 * cy));
+    const QRgb *line1 = reinterpret_cast<const QRgb*>(image.constScanLine(qMin(2 * cy + 1, h - 1)));
+
+    for(int cx=0; cx < cw; cx++)
+    {
+      int x0 = 2 * cx;
+      int x1 = qMin(x0 + 1, w - 1);
+
+      int r = (qRed(line0[x0]) + qRed(line0[x1]) + qRed(line1[x0]) + qRed(line1[x1]) + 2) / 4;
+      int g = (qGreen(line0[x0]) + qGreen(line0[x1]) + qGreen(line1[x0]) + qGreen(line1[x1]) + 2) / 4;
+      int b = (qBlue(line0[x0]) + qBlue(line0[x1]) + qBlue(line1[x0]) + qBlue(line1[x1]) + 2) / 4;
+
+      u[cy * cw + cx] = (uchar) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+      v[cy * cw + cx] = (uchar) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+  }
+
+  for(int i=0; i < repeat; i++)
+  {
+    if(this->write(frame) == false) { return false; }
+  }
+
+  return true;
+}
+
+bool SeY4mWriter::verify()
+{
+  QFile f(mFilename);
+  if(f.open(QIODevice::ReadOnly) == false) { return false; }
+
+  QByteArray header = f.readLine();
+  if(header.startsWith("YUV4MPEG2 ") == false) { return false; }
+
+  int w = 0, h = 0;
+  for(const QByteArray & token : header.trimmed().split(' '))
+  {
+    if(token.startsWith('W')) { w = token.mid(1).toInt(); }
+    if(token.startsWith('H')) { h = token.mid(1).toInt(); }
+  }
+  if(w != mSize.width() || h != mSize.height()) { return false; }
+
+  const qint64 bytes = this->frameBytes();
+  int frames = 0;
+
+  while(f.atEnd() == false)
+  {
+    if(f.readLine().startsWith("FRAME") == false) { return false; }
+    if(f.skip(bytes) != bytes) { return false; }
+    frames++;
+  }
+
+  return frames == mNumberOfFrames;
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeRawVideoWriter::SeRawVideoWriter(const QString & filename)
+  : SeVideoWriter(filename)
+  , mUniqueFrames(0)
+{
+}
+
+bool SeRawVideoWriter::writeHeader()
+{
+  mUniqueFrames = 0;
+  mTiming.clear();
+  mTiming.append(QString("# SceneEditor raw video, rgb24, frame <index> <repeat>\n").toLatin1());
+  mTiming.append(QString("size %1 %2\n").arg(mSize.width()).arg(mSize.height()).toLatin1());
+  mTiming.append(QString("rate %1 %2\n").arg(mRate).arg(mScale).toLatin1());
+  return true;
+}
+
+bool SeRawVideoWriter::writeImage(const QImage & image, int repeat)
+{
+  QByteArray rgb;
+  rgb.resize(mSize.width() * mSize.height() * 3);
+  char *p = rgb.data();
+
+  for(int iy=0; iy < mSize.height(); iy++)
+  {
+    const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(iy));
+    for(int ix=0; ix < mSize.width(); ix++)
+    {
+      *p++ = (char) qRed(line[ix]);
+      *p++ = (char) qGreen(line[ix]);
+      *p++ = (char) qBlue(line[ix]);
+    }
+  }
+
+  if(this->write(rgb) == false) { return false; }
+
+  mTiming.append(QString("frame %1 %2\n").arg(mUniqueFrames++).arg(repeat).toLatin1());
+
+  return true;
+}
+
+bool SeRawVideoWriter::writeTrailer()
+{
+  QFile f(this->timingFilename());
+  if(f.open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+  {
+    mErrorString = f.errorString();
+    return false;
+  }
+  return f.write(mTiming) == mTiming.size();
+}
+
+bool SeRawVideoWriter::verify()
+{
+  QFileInfo info(mFilename);
+  const qint64 frameBytes = (qint64) mSize.width() * mSize.height() * 3;
+  if(frameBytes <= 0 || info.size() != frameBytes * mUniqueFrames) { return false; }
+
+  QFile f(this->timingFilename());
+  if(f.open(QIODevice::ReadOnly | QIODevice::Text) == false) { return false; }
+
+  int frames = 0;
+  int repeats = 0;
+
+  QTextStream s(&f);
+  while(s.atEnd() == false)
+  {
+    QStringList tokens = s.readLine().split(' ', QString::SkipEmptyParts);
+    if(tokens.count() == 3 && tokens.at(0) == "frame")
+    {
+      frames++;
+      repeats += tokens.at(2).toInt();
+    }
+  }
+
+  return frames == mUniqueFrames && repeats == mNumberOfFrames;
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeMjpegAviWriter::SeMjpegAviWriter(const QString & filename, int quality)
+  : SeVideoWriter(filename)
+  , mQuality(quality)
+  , mMoviOffset(0)
+  , mMaxChunkSize(0)
+  , mTotalFramesOffset(0)
+  , mLengthOffset(0)
+{
+  mBufferSizeOffsets[0] = 0;
+  mBufferSizeOffsets[1] = 0;
+}
+
+bool SeMjpegAviWriter::writeHeader()
+{
+  const int w = mSize.width();
+  const int h = mSize.height();
+
+  QByteArray hdr;
+  hdr.append("RIFF", 4);
+  appendU32LE(hdr, 0);                        // patched
+  hdr.append("AVI ", 4);
+
+  hdr.append("LIST", 4);
+  appendU32LE(hdr, 4 + (8 + 56) + (12 + (8 + 56) + (8 + 40)));
+  hdr.append("hdrl", 4);
+
+  hdr.append("avih", 4);
+  appendU32LE(hdr, 56);
+  appendU32LE(hdr, qRound(this->msecOf(1) * 1000.0)); // microseconds per frame
+  appendU32LE(hdr, 0);                        // max bytes per second
+  appendU32LE(hdr, 0);                        // padding granularity
+  appendU32LE(hdr, 0x10);                     // AVIF_HASINDEX
+  mTotalFramesOffset = hdr.size();
+  appendU32LE(hdr, 0);                        // total frames, patched
+  appendU32LE(hdr, 0);                        // initial frames
+  appendU32LE(hdr, 1);                        // streams
+  mBufferSizeOffsets[0] = hdr.size();
+  appendU32LE(hdr, 0);                        // suggested buffer size, patched
+  appendU32LE(hdr, w);
+  appendU32LE(hdr, h);
+  for(int i=0; i < 4; i++) { appendU32LE(hdr, 0); }
+
+  hdr.append("LIST", 4);
+  appendU32LE(hdr, 4 + (8 + 56) + (8 + 40));
+  hdr.append("strl", 4);
+
+  hdr.append("strh", 4);
+  appendU32LE(hdr, 56);
+  hdr.append("vids", 4);
+  hdr.append("MJPG", 4);
+  appendU32LE(hdr, 0);                        // flags
+  appendU32LE(hdr, 0);                        // priority, language
+  appendU32LE(hdr, 0);                        // initial frames
+  appendU32LE(hdr, mScale);                   // scale
+  appendU32LE(hdr, mRate);                    // rate, i.e. rate / scale fps
+  appendU32LE(hdr, 0);                        // start
+  mLengthOffset = hdr.size();
+  appendU32LE(hdr, 0);                        // length, patched
+  mBufferSizeOffsets[1] = hdr.size();
+  appendU32LE(hdr, 0);                        // suggested buffer size, patched
+  appendU32LE(hdr, 0xffffffff);               // quality
+  appendU32LE(hdr, 0);                        // sample size
+  appendU16LE(hdr, 0);
+  appendU16LE(hdr, 0);
+  appendU16LE(hdr, w);
+  appendU16LE(hdr, h);
+
+  hdr.append("strf", 4);
+  appendU32LE(hdr, 40);
+  appendU32LE(hdr, 40);                       // BITMAPINFOHEADER size
+  appendU32LE(hdr, w);
+  appendU32LE(hdr, h);
+  appendU16LE(hdr, 1);                        // planes
+  appendU16LE(hdr, 24);                       // bits per pixel
+  hdr.append("MJPG", 4);
+  appendU32LE(hdr, w * h * 3);
+  for(int i=0; i < 4; i++) { appendU32LE(hdr, 0); }
+
+  hdr.append("LIST", 4);
+  appendU32LE(hdr, 0);                        // patched
+  mMoviOffset = hdr.size();
+  hdr.append("movi", 4);
+
+  mIndex.clear();
+  mMaxChunkSize = 0;
+
+  return this->write(hdr);
+}
+
+bool SeMjpegAviWriter::writeImage(const QImage & image, int repeat)
+{
+  QByteArray jpeg;
+  QBuffer buffer(&jpeg);
+  buffer.open(QIODevice::WriteOnly);
+  if(image.save(&buffer, "JPG", mQuality) == false)
+  {
+    mErrorString = "JPEG encoding failed, is the Qt JPEG plugin available?";
+    return false;
+  }
+
+  QByteArray chunk("00dc");
+  appendU32LE(chunk, jpeg.size());
+  chunk.append(jpeg);
+  if(jpeg.size() & 1) { chunk.append((char) 0); }
+
+  mMaxChunkSize = qMax(mMaxChunkSize, (quint32) jpeg.size());
+
+  mIndex.append("00dc", 4);
+  appendU32LE(mIndex, 0x10);                  // AVIIF_KEYFRAME
+  appendU32LE(mIndex, (quint32) (mFile.pos() - mMoviOffset));
+  appendU32LE(mIndex, jpeg.size());
+
+  if(this->write(chunk) == false) { return false; }
+
+  // empty chunks make players repeat the previous frame, i.e. a held
+  // frame costs eight bytes per repetition instead of a whole JPEG
+  QByteArray empty;
+  const qint64 offset = mFile.pos() - mMoviOffset;
+
+  for(int i=1; i < repeat; i++)
+  {
+    mIndex.append("00dc", 4);
+    appendU32LE(mIndex, 0);
+    appendU32LE(mIndex, (quint32) (offset + empty.size()));
+    appendU32LE(mIndex, 0);
+
+    empty.append("00dc", 4);
+    appendU32LE(empty, 0);
+  }
+
+  return empty.isEmpty() || this->write(empty);
+}
+
+bool SeMjpegAviWriter::writeTrailer()
+{
+  const qint64 moviEnd = mFile.pos();
+
+  QByteArray idx("idx1");
+  appendU32LE(idx, mIndex.size());
+  idx.append(mIndex);
+  if(this->write(idx) == false) { return false; }
+
+  const qint64 fileEnd = mFile.pos();
+
+  auto patch = [&](qint64 offset, quint32 value) {
+    QByteArray v;
+    appendU32LE(v, value);
+    mFile.seek(offset);
+    return mFile.write(v) == 4;
+  };
+
+  bool res = true;
+  res &= patch(4, (quint32) (fileEnd - 8));
+  res &= patch(mMoviOffset - 4, (quint32) (moviEnd - mMoviOffset));
+  res &= patch(mTotalFramesOffset, mNumberOfFrames);
+  res &= patch(mLengthOffset, mNumberOfFrames);
+  res &= patch(mBufferSizeOffsets[0], mMaxChunkSize + 8);
+  res &= patch(mBufferSizeOffsets[1], mMaxChunkSize + 8);
+
+  mFile.seek(fileEnd);
+
+  return res;
+}
+
+bool SeMjpegAviWriter::verify()
+{
+  QFile f(mFilename);
+  if(f.open(QIODevice::ReadOnly) == false) { return false; }
+
+  QByteArray data = f.readAll();
+  if(data.size() < 12 || data.left(4) != "RIFF" || data.mid(8, 4) != "AVI ") { return false; }
+  if(readU32LE(data.constData() + 4) != (quint32) data.size() - 8) { return false; }
+
+  quint32 totalFrames = readU32LE(data.constData() + mTotalFramesOffset);
+
+  // walk the top-level chunks up to the index
+  int pos = 12;
+  while(pos + 8 <= data.size())
+  {
+    QByteArray id = data.mid(pos, 4);
+    quint32 size = readU32LE(data.constData() + pos + 4);
+
+    if(id == "idx1")
+    {
+      int entries = size / 16;
+      return entries == mNumberOfFrames && totalFrames == (quint32) mNumberOfFrames;
+    }
+
+    pos += 8 + size + (size & 1);
+  }
+
+  return false;
+}
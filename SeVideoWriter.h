@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2015, Christian Benjamin Ries
+ * Website: http://www.christianbenjaminries.de
+ * License: MIT License, http://opensource.org/licenses/MIT
+ */
+
+#pragma once
+
+#ifndef __SEVIDEOWRITER_H__
+#define __SEVIDEOWRITER_H__
+
+// Qt
+#include <QFile>
+#include <QSize>
+#include <QImage>
+#include <QString>
+#include <QByteArray>
+
+/**
+ * @brief The SeVideoWriter class
+ *
+ * Base of the built-in video writers, used when ffmpeg is not 
+ * available. Frames are streamed to the file as they are rendered,
+ * a frame shown for several steps is encoded once and repeated.
+ * verify() reads the finished file back and checks its frame count.
+ */
+class SeVideoWriter
+{
+public:
+  explicit SeVideoWriter(const QString & filename);
+  virtual ~SeVideoWriter();
+
+  //! \return A writer matching the suffix of \p filename, i.e. ".y4m",
+  //!         ".rgb", ".raw" or ".avi", NULL for any other suffix.
+  static SeVideoWriter *create(const QString & filename);
+  static bool isSupported(const QString & filename);
+
+  //! \p fps is stored as a fraction with millihertz precision.
+  bool open(const QSize & size, double fps);
+  //! Appends \p image for \p repeat frames.
+  bool writeFrame(const QImage & image, int repeat=1);
+  bool close();
+
+  virtual bool verify() = 0;
+
+  const QString & filename() const { return mFilename; }
+  const QString & errorString() const { return mErrorString; }
+  int numberOfFrames() const { return mNumberOfFrames; }
+
+protected:
+  virtual bool writeHeader() = 0;
+  virtual bool writeImage(const QImage & image, int repeat) = 0;
+  virtual bool writeTrailer() = 0;
+
+  bool write(const QByteArray & data);
+  static void appendU16LE(QByteArray & out, int v);
+  static void appendU32LE(QByteArray & out, quint32 v);
+  static quint32 readU32LE(const char *p);
+
+  //! \return Duration of \p frames in milliseconds.
+  double msecOf(int frames) const { return frames * 1000.0 * mScale / mRate; }
+
+  QString mFilename;
+  QFile mFile;
+  QSize mSize;
+  int mRate;   //!< frames per mScale seconds
+  int mScale;
+  int mNumberOfFrames;
+  QString mErrorString;
+};
+
+/**
+ * @brief The SeY4mWriter class
+ *
+ * YUV4MPEG2 stream, 4:2:0 with BT.601 limited range coefficients.
+ */
+class SeY4mWriter
+  : public SeVideoWriter
+{
+public:
+  explicit SeY4mWriter(const QString & filename);
+  bool verify();
+
+protected:
+  bool writeHeader();
+  bool writeImage(const QImage & image, int repeat);
+  bool writeTrailer() { return true; }
+
+private:
+  int frameBytes() const;
+};
+
+/**
+ * @brief The SeRawVideoWriter class
+ *
+ * Unique RGB24 frames back to back, the sidecar file "<name>.txt" 
+ * lists the size, the frame rate and for how many frames each
+ * stored frame is shown.
+ */
+class SeRawVideoWriter
+  : public SeVideoWriter
+{
+public:
+  explicit SeRawVideoWriter(const QString & filename);
+  bool verify();
+
+  QString timingFilename() const { return mFilename + ".txt"; }
+
+protected:
+  bool writeHeader();
+  bool writeImage(const QImage & image, int repeat);
+  bool writeTrailer();
+
+private:
+  QByteArray mTiming;
+  int mUniqueFrames;
+};
+
+/**
+ * @brief The SeMjpegAviWriter class
+ *
+ * AVI with a single Motion-JPEG stream encoded by Qt's JPEG plugin,
+ * the header sizes and frame counts are patched on close().
+ */
+class SeMjpegAviWriter
+  : public SeVideoWriter
+{
+public:
+  explicit SeMjpegAviWriter(const QString & filename, int quality=90);
+  bool verify();
+
+protected:
+  bool writeHeader();
+  bool writeImage(const QImage & image, int repeat);
+  bool writeTrailer();
+
+private:
+  int mQuality;
+  QByteArray mIndex;
+  qint64 mMoviOffset;
+  quint32 mMaxChunkSize;
+
+  // offsets of the fields patched by writeTrailer()
+  qint64 mTotalFramesOffset;
+  qint64 mLengthOffset;
+  qint64 mBufferSizeOffsets[2];
+};
+
+#endif // __SEVIDEOWRITER_H__
@@ -8,21 +8,200 @@
 #include <SeWebSocket.h>
 
 // Qt
+#include <QFile>
 #include <QDebug>
+#include <QJsonArray>
 #include <QWebSocket>
+#include <QJsonDocument>
 #include <QAbstractSocket>
 
+// ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+SeWebSocketStats::SeWebSocketStats()
+{
+    this->reset();
+}
+
+void SeWebSocketStats::reset()
+{
+    mOpenedAt = -1;
+    mConnectedAt = -1;
+    mFirstSentAt = -1;
+    mLastSentAt = -1;
+    mFirstReceivedAt = -1;
+    mLastReceivedAt = -1;
+    mClosedAt = -1;
+
+    mMessagesSent = 0;
+    mMessagesReceived = 0;
+    mBytesSent = 0;
+    mBytesReceived = 0;
+
+    mRttMin = -1;
+    mRttMax = -1;
+    mRttSum = 0;
+    mRttSamples = 0;
+    mRttHistogram.fill(0, rttBuckets());
+
+    mClock.start();
+}
+
+void SeWebSocketStats::opening()
+{
+    this->reset();
+    mOpenedAt = 0;
+}
+
+void SeWebSocketStats::connected()
+{
+    mConnectedAt = mClock.elapsed();
+}
+
+void SeWebSocketStats::sent(qint64 bytes)
+{
+    qint64 t = mClock.elapsed();
+    if(mFirstSentAt < 0) { mFirstSentAt = t; }
+    mLastSentAt = t;
+
+    ++mMessagesSent;
+    mBytesSent += bytes;
+}
+
+void SeWebSocketStats::received(qint64 bytes)
+{
+    qint64 t = mClock.elapsed();
+    if(mFirstReceivedAt < 0) { mFirstReceivedAt = t; }
+    mLastReceivedAt = t;
+
+    ++mMessagesReceived;
+    mBytesReceived += bytes;
+
+    if(mLastSentAt < 0) { return; }
+
+    qint64 rtt = t - mLastSentAt;
+    if(mRttMin < 0 || rtt < mRttMin) { mRttMin = rtt; }
+    if(rtt > mRttMax) { mRttMax = rtt; }
+    mRttSum += rtt;
+    ++mRttSamples;
+
+    int bucket = 0;
+    while(bucket < rttBuckets() - 1 && rtt >= rttBucketLimit(bucket))
+    {
+        ++bucket;
+    }
+    ++mRttHistogram[bucket];
+}
+
+void SeWebSocketStats::closed()
+{
+    mClosedAt = mClock.elapsed();
+}
+
+qint64 SeWebSocketStats::connectMsec() const
+{
+    if(mOpenedAt < 0 || mConnectedAt < 0) { return -1; }
+    return mConnectedAt - mOpenedAt;
+}
+
+qint64 SeWebSocketStats::firstAckMsec() const
+{
+    if(mFirstSentAt < 0 || mFirstReceivedAt < 0) { return -1; }
+    return mFirstReceivedAt - mFirstSentAt;
+}
+
+qint64 SeWebSocketStats::transferMsec() const
+{
+    if(mFirstSentAt < 0 || mLastReceivedAt < 0) { return -1; }
+    return mLastReceivedAt - mFirstSentAt;
+}
+
+double SeWebSocketStats::messagesPerSecond() const
+{
+    qint64 msec = this->transferMsec();
+    if(msec <= 0) { return 0.0; }
+    return (mMessagesSent + mMessagesReceived) * 1000.0 / msec;
+}
+
+double SeWebSocketStats::bytesPerSecond() const
+{
+    qint64 msec = this->transferMsec();
+    if(msec <= 0) { return 0.0; }
+    return (mBytesSent + mBytesReceived) * 1000.0 / msec;
+}
+
+qint64 SeWebSocketStats::rttBucketLimit(int bucket)
+{
+    if(bucket >= rttBuckets() - 1) { return -1; }
+    return Q_INT64_C(1) << bucket;
+}
+
+QJsonObject SeWebSocketStats::toJson() const
+{
+    QJsonObject o;
+
+    o["ConnectMsec"] = (double) this->connectMsec();
+    o["FirstAckMsec"] = (double) this->firstAckMsec();
+    o["TransferMsec"] = (double) this->transferMsec();
+    o["SessionMsec"] = (double) (mClosedAt < 0 ? mClock.elapsed() : mClosedAt);
+
+    o["MessagesSent"] = (double) mMessagesSent;
+    o["MessagesReceived"] = (double) mMessagesReceived;
+    o["BytesSent"] = (double) mBytesSent;
+    o["BytesReceived"] = (double) mBytesReceived;
+    o["MessagesPerSecond"] = this->messagesPerSecond();
+    o["BytesPerSecond"] = this->bytesPerSecond();
+
+    QJsonObject rtt;
+    rtt["MinMsec"] = (double) mRttMin;
+    rtt["MaxMsec"] = (double) mRttMax;
+    rtt["AvgMsec"] = mRttSamples > 0 ? mRttSum / (double) mRttSamples : -1.0;
+
+    QJsonArray histogram;
+    for(int i=0; i < mRttHistogram.count(); i++)
+    {
+        QJsonObject bucket;
+        bucket["BelowMsec"] = (double) rttBucketLimit(i);
+        bucket["Count"] = (double) mRttHistogram.at(i);
+        histogram.append(bucket);
+    }
+    rtt["Histogram"] = histogram;
+
+    o["Rtt"] = rtt;
+
+    return o;
+}
+
+bool SeWebSocketStats::dump(const QString &filename) const
+{
+    QJsonDocument doc;
+    doc.setObject(this->toJson());
+
+    QFile f(filename);
+    if(f.open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+    {
+        return false;
+    }
+
+    f.write(doc.toJson());
+    f.close();
+
+    return true;
+}
+
+// ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
 SeWebSocket::SeWebSocket(QObject *parent) 
     : QObject(parent)
 {
     QObject::connect(&mWebSocket, &QWebSocket::connected, this, &SeWebSocket::onConnected);
     QObject::connect(&mWebSocket, &QWebSocket::textMessageReceived, this, &SeWebSocket::onMessageReceived);       
-    QObject::connect(&mWebSocket, &QWebSocket::disconnected, this, &SeWebSocket::closed);    
+    QObject::connect(&mWebSocket, &QWebSocket::disconnected, this, &SeWebSocket::onDisconnected);    
 }
 
 void SeWebSocket::setUrlAndConnect(const QUrl &url)
 {
     mUrl = url;
+    mStats.opening();
     mWebSocket.open(QUrl(mUrl));
 }
 
@@ -30,7 +209,9 @@ bool SeWebSocket::send(const QString &message)
 {
     if(message.isEmpty()) return false;
     if(mWebSocket.state() != QAbstractSocket::SocketState::ConnectedState) return false;
-    bool res = mWebSocket.sendTextMessage(message) > 0;
+    qint64 bytes = mWebSocket.sendTextMessage(message);
+    bool res = bytes > 0;
+    if(res) { mStats.sent(bytes); }
     return res;
 }
 
@@ -41,10 +222,18 @@ void SeWebSocket::shutdown()
 
 void SeWebSocket::onConnected()
 {
+    mStats.connected();
     emit connected();
 }
 
+void SeWebSocket::onDisconnected()
+{
+    mStats.closed();
+    emit closed();
+}
+
 void SeWebSocket::onMessageReceived(QString m)
 {
+    mStats.received(m.toUtf8().size());
     emit message(m);
 }
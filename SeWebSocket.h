@@ -10,8 +10,84 @@
 #define __SEWEBSOCKET_H__
 
 #include <QtCore/QObject>
+#include <QtCore/QVector>
+#include <QtCore/QJsonObject>
+#include <QtCore/QElapsedTimer>
 #include <QtWebSockets/QWebSocket>
 
+/**
+ * @brief The SeWebSocketStats class
+ *
+ * Timestamped counters of one WebSocket session, i.e. from opening
+ * the connection until it is closed again. All times are milliseconds
+ * relative to the moment the connection has been requested.
+ * The round-trip time of a reply is measured from the most recent
+ * sent message, the Node.js target answers every grid command with
+ * one state message per LED.
+ */
+class SeWebSocketStats
+{
+public:
+    SeWebSocketStats();
+
+    void reset();
+
+    void opening();
+    void connected();
+    void sent(qint64 bytes);
+    void received(qint64 bytes);
+    void closed();
+
+    //! Time from opening the socket until the connection is established, -1 if unknown.
+    qint64 connectMsec() const;
+    //! Time from the first sent message until the first reply, -1 if unknown.
+    qint64 firstAckMsec() const;
+    //! Time from the first sent message until the last reply, -1 if unknown.
+    qint64 transferMsec() const;
+
+    qint64 messagesSent() const { return mMessagesSent; }
+    qint64 messagesReceived() const { return mMessagesReceived; }
+    qint64 bytesSent() const { return mBytesSent; }
+    qint64 bytesReceived() const { return mBytesReceived; }
+
+    double messagesPerSecond() const;
+    double bytesPerSecond() const;
+
+    //! Number of RTT buckets, bucket i counts replies with an
+    //! RTT below 2^i msec, the last bucket collects the rest.
+    static int rttBuckets() { return 12; }
+    static qint64 rttBucketLimit(int bucket);
+    const QVector<qint64> & rttHistogram() const { return mRttHistogram; }
+
+    QJsonObject toJson() const;
+    bool dump(const QString & filename) const;
+
+private:
+    QElapsedTimer mClock;
+
+    qint64 mOpenedAt;
+    qint64 mConnectedAt;
+    qint64 mFirstSentAt;
+    qint64 mLastSentAt;
+    qint64 mFirstReceivedAt;
+    qint64 mLastReceivedAt;
+    qint64 mClosedAt;
+
+    qint64 mMessagesSent;
+    qint64 mMessagesReceived;
+    qint64 mBytesSent;
+    qint64 mBytesReceived;
+
+    qint64 mRttMin;
+    qint64 mRttMax;
+    qint64 mRttSum;
+    qint64 mRttSamples;
+    QVector<qint64> mRttHistogram;
+};
+
+/**
+ * @brief The SeWebSocket class
+ */
 class SeWebSocket : public QObject
 {
     Q_OBJECT
@@ -21,6 +97,8 @@ public:
     bool send(const QString & message);
     void shutdown();
 
+    const SeWebSocketStats & stats() const { return mStats; }
+
 Q_SIGNALS:
     void message(QString m);
     void connected();
@@ -28,11 +106,13 @@ Q_SIGNALS:
 
 private Q_SLOTS:
     void onConnected();
+    void onDisconnected();
     void onMessageReceived(QString message);
 
 private:
     QWebSocket mWebSocket;
     QUrl mUrl;
+    SeWebSocketStats mStats;
 };
 
 #endif // __SEWEBSOCKET_H__